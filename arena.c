@@ -0,0 +1,185 @@
+/*
+   arena.c, .h: module for bump-allocating many small objects (data records
+      and their strings) in large contiguous blocks
+   All memory taken from an arena, and all files mapped into it, are
+      released at once by arenaFree(), in time proportional to the number
+      of blocks.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "arena.h"
+
+// every allocation is rounded up to a multiple of this
+#define ARENA_ALIGN (sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double))
+
+typedef struct ablock ablock_t;
+struct ablock {
+  ablock_t *next;       // previously filled block
+  size_t size;          // capacity of mem[]
+  size_t used;          // bytes of mem[] already handed out
+  char mem[];
+};
+
+typedef struct amap amap_t;
+struct amap {
+  amap_t *next;
+  void *addr;           // start of a mapped file
+  size_t len;           // length of the mapping
+};
+
+struct arena {
+  ablock_t *head;       // current block, allocations are bumped from here
+  size_t blockSize;     // capacity of a regular block
+  amap_t *maps;         // files mapped into this arena
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+static ablock_t *ablockCreate(size_t size) {
+  ablock_t *b = myMalloc(sizeof(*b) + size);
+  b->next = NULL;
+  b->size = size;
+  b->used = 0;
+  return b;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create an empty arena whose blocks hold (at least) blockSize bytes
+arena_t *arenaCreate(size_t blockSize) {
+  assert(blockSize > 0);
+  arena_t *arena = myMalloc(sizeof(*arena));
+  arena->head = NULL;
+  arena->blockSize = blockSize;
+  arena->maps = NULL;
+  return arena;
+}
+
+// return "size" bytes of suitably aligned memory owned by arena
+void *arenaAlloc(arena_t *arena, size_t size) {
+  assert(arena);
+  size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  ablock_t *b = arena->head;
+  if (b && b->used + size <= b->size) {
+    void *p = b->mem + b->used;
+    b->used += size;
+    return p;
+  }
+
+  if (size > arena->blockSize / 4) {
+    // big request: give it a block of its own, and keep bumping the current one
+    ablock_t *big = ablockCreate(size);
+    big->used = size;
+    if (b) {
+      big->next = b->next;
+      b->next = big;
+    } else {
+      arena->head = big;
+    }
+    return big->mem;
+  }
+
+  b = ablockCreate(arena->blockSize);
+  b->next = arena->head;
+  arena->head = b;
+  b->used = size;
+  return b->mem;
+}
+
+// copy the first len chars of s into arena, adding a terminating '\0'
+char *arenaStrdup(arena_t *arena, const char *s, size_t len) {
+  char *t = arenaAlloc(arena, len + 1);
+  memcpy(t, s, len);
+  t[len] = '\0';
+  return t;
+}
+
+// map file fname privately (copy-on-write) into arena, return its content
+//    and set *size to its length; buf[*size] is always a writable '\0'
+//    the mapping is released by arenaFree()
+char *arenaMapFile(arena_t *arena, const char *fname, size_t *size) {
+  int fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    perror(fname);
+    error("arenaMapFile: cannot open file");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    error("arenaMapFile: cannot stat file");
+  }
+  *size = st.st_size;
+
+  // reserve one byte more than the file, rounded up to whole pages, so that
+  //    the byte after the content is zero-filled memory rather than SIGBUS
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t len = (*size + 1 + page - 1) / page * page;
+  char *buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf == MAP_FAILED) {
+    error("arenaMapFile: cannot reserve memory");
+  }
+  if (*size > 0 && mmap(buf, *size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    error("arenaMapFile: cannot map file");
+  }
+  close(fd);
+  madvise(buf, *size, MADV_SEQUENTIAL);
+
+  amap_t *m = myMalloc(sizeof(*m));
+  m->addr = buf;
+  m->len = len;
+  m->next = arena->maps;
+  arena->maps = m;
+  return buf;
+}
+
+// move all blocks and mappings of arena "src" into "dst", and free "src"
+void arenaMerge(arena_t *dst, arena_t *src) {
+  assert(dst && src);
+  if (src->head) {
+    // splice src's blocks behind dst's current one, which keeps bumping
+    ablock_t *tail = src->head;
+    while (tail->next) {
+      tail = tail->next;
+    }
+    if (dst->head) {
+      tail->next = dst->head->next;
+      dst->head->next = src->head;
+    } else {
+      dst->head = src->head;
+    }
+  }
+  while (src->maps) {
+    amap_t *m = src->maps;
+    src->maps = m->next;
+    m->next = dst->maps;
+    dst->maps = m;
+  }
+  free(src);
+}
+
+// free all blocks of arena, together with everything allocated from it
+void arenaFree(arena_t *arena) {
+  assert(arena);
+  amap_t *m = arena->maps;
+  while (m) {
+    amap_t *tmp = m;
+    m = m->next;
+    munmap(tmp->addr, tmp->len);
+    free(tmp);
+  }
+  ablock_t *b = arena->head;
+  while (b) {
+    ablock_t *tmp = b;
+    b = b->next;
+    free(tmp);
+  }
+  free(arena);
+}
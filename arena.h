@@ -0,0 +1,39 @@
+/*
+   arena.c, .h: module for bump-allocating many small objects (data records
+      and their strings) in large contiguous blocks
+   All memory taken from an arena, and all files mapped into it, are
+      released at once by arenaFree(), in time proportional to the number
+      of blocks.
+*/
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+// default size of a single arena block
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+typedef struct arena arena_t;
+
+// create an empty arena whose blocks hold (at least) blockSize bytes
+arena_t *arenaCreate(size_t blockSize);
+
+// return "size" bytes of suitably aligned memory owned by arena
+void *arenaAlloc(arena_t *arena, size_t size);
+
+// copy the first len chars of s into arena, adding a terminating '\0'
+char *arenaStrdup(arena_t *arena, const char *s, size_t len);
+
+// map file fname privately (copy-on-write) into arena, return its content
+//    and set *size to its length; buf[*size] is always a writable '\0'
+//    the mapping is released by arenaFree()
+char *arenaMapFile(arena_t *arena, const char *fname, size_t *size);
+
+// move all blocks and mappings of arena "src" into "dst", and free "src"
+void arenaMerge(arena_t *dst, arena_t *src);
+
+// free all blocks of arena, together with everything allocated from it
+void arenaFree(arena_t *arena);
+
+#endif
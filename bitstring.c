@@ -0,0 +1,83 @@
+/*
+   bitstring.c, .h: module of bit-string kernels working a 64-bit word at
+      a time, bits are numbered from the highest order bit of byte 0
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "utils.h"
+#include "bitstring.h"
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// load 8 bytes so that byte 0 is the highest order one
+static inline uint64_t loadWord(const char *p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+  return w;
+}
+
+// number of leading zero bits of a non-zero byte
+static inline unsigned int clz8(unsigned int byte) {
+  return __builtin_clz(byte) - (sizeof(unsigned int) - 1) * BITS_PER_BYTE;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// return the index of the first bit where a and b differ among their
+//    first nbits bits, or nbits if they all match
+//    both a and b must hold at least (nbits + 7) / 8 bytes
+unsigned int bitsMismatch(const char *a, const char *b, unsigned int nbits) {
+  unsigned int nbytes = nbits / BITS_PER_BYTE;
+  unsigned int i = 0;
+  for (; i + sizeof(uint64_t) <= nbytes; i += sizeof(uint64_t)) {
+    uint64_t diff = loadWord(a + i) ^ loadWord(b + i);
+    if (diff) {
+      return i * BITS_PER_BYTE + __builtin_clzll(diff);
+    }
+  }
+  for (; i < nbytes; i++) {
+    unsigned int diff = (unsigned char) (a[i] ^ b[i]);
+    if (diff) {
+      return i * BITS_PER_BYTE + clz8(diff);
+    }
+  }
+  unsigned int rest = nbits % BITS_PER_BYTE;
+  if (rest) {
+    unsigned int diff = (unsigned char) (a[i] ^ b[i]) & (0xff << (BITS_PER_BYTE - rest));
+    if (diff) {
+      return i * BITS_PER_BYTE + clz8(diff);
+    }
+  }
+  return nbits;
+}
+
+// copy numBits bits of src, starting from bit startBit, to the start of dst,
+//    clearing the bits after them in the last byte of dst
+void bitsCopy(char *dst, const char *src, unsigned int startBit, unsigned int numBits) {
+  unsigned int nbytes = (numBits + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+  unsigned int shift = startBit % BITS_PER_BYTE;
+  const unsigned char *s = (const unsigned char *) src + startBit / BITS_PER_BYTE;
+  if (shift == 0) {
+    memcpy(dst, s, nbytes);
+  } else {
+    // the last source byte is only read if it holds some of the bits
+    unsigned int lastByte = (shift + numBits - 1) / BITS_PER_BYTE;
+    for (unsigned int j = 0; j < nbytes; j++) {
+      unsigned int byte = s[j] << shift;
+      if (j + 1 <= lastByte) {
+        byte |= s[j + 1] >> (BITS_PER_BYTE - shift);
+      }
+      dst[j] = byte;
+    }
+  }
+  if (numBits % BITS_PER_BYTE) {
+    dst[nbytes - 1] &= 0xff << (BITS_PER_BYTE - numBits % BITS_PER_BYTE);
+  }
+}
@@ -0,0 +1,23 @@
+/*
+   bitstring.c, .h: module of bit-string kernels working a 64-bit word at
+      a time, bits are numbered from the highest order bit of byte 0
+*/
+
+#ifndef _BITSTRING_H_
+#define _BITSTRING_H_
+
+// get bit number i of s
+static inline int bitsGet(const char *s, unsigned int i) {
+  return ((unsigned char) s[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+// return the index of the first bit where a and b differ among their
+//    first nbits bits, or nbits if they all match
+//    both a and b must hold at least (nbits + 7) / 8 bytes
+unsigned int bitsMismatch(const char *a, const char *b, unsigned int nbits);
+
+// copy numBits bits of src, starting from bit startBit, to the start of dst,
+//    clearing the bits after them in the last byte of dst
+void bitsCopy(char *dst, const char *src, unsigned int startBit, unsigned int numBits);
+
+#endif
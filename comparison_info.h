@@ -7,6 +7,25 @@ typedef struct comparison_info {
 	int bit_comparisons;
 	int node_accesses;
 	int string_comparisons;
+	int pruned_nodes; // subtrees skipped by a bounded search
 } comparison_info_t;
 
+// search kernels are written once, in a .inc file that their module includes
+// twice: with COUNTING defined as 1, then as 0; in the kernels, KERNEL(name)
+// names the variant (name_counted or name_fast), COUNT(statement) is only
+// kept in the counting one, and COUNTED(counting, fast) picks an expression,
+// so that the fast variant never touches its comparison_info_t
+#define KERNEL(name) KERNEL_(COUNTING, name)
+#define KERNEL_(counting, name) KERNEL__(counting, name)
+#define KERNEL__(counting, name) KERNEL_##counting(name)
+#define KERNEL_1(name) name##_counted
+#define KERNEL_0(name) name##_fast
+
+#define COUNT(statement) COUNTED(statement, (void) 0)
+#define COUNTED(counting, fast) COUNTED_(COUNTING, counting, fast)
+#define COUNTED_(c, counting, fast) COUNTED__(c, counting, fast)
+#define COUNTED__(c, counting, fast) COUNTED_##c(counting, fast)
+#define COUNTED_1(counting, fast) (counting)
+#define COUNTED_0(counting, fast) (fast)
+
 #endif
\ No newline at end of file
@@ -10,125 +10,305 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <pthread.h>
 #include "utils.h"
 #include "data.h"
+#include "format.h"
 
-// read and parse the csv header line from file f
-//    assuming always successful
+// where lazy records decode their rows, shared by all records of a file
+struct lazySource {
+  arena_t *arena;         // receives the decoded copies of the rows
+  intern_t *interns;      // interns the decoded strings, or NULL
+  pthread_mutex_t lock;   // guards arena and the lazy fields of records
+};
+
+// read and parse the csv header line from the memory buffer at *pos,
+//    advancing *pos to the first data line
 //    reurn: NULL-terminated array of strings
-char **dataGetLabels(FILE *f) {
+char **dataParseLabels(char **pos, char *end) {
   char **labels = myCalloc(COLS + 1, sizeof(*labels));
   for (int i = 0; i < COLS; i++) {
-    labels[i] = getCsvString(f);
+    char *label = parseCsvString(pos, end);
+    labels[i] = label ? myStrdup(label) : NULL;
   }
   return labels;
 }
 
+// discard the rest of a badly-formatted line
+static void dataSkipLine(char **pos, char *end, int recId, char *message) {
+  warning(message);
+  fprintf(stderr, "RecID = %d ignored\n", recId);
+  parseSkipLine(pos, end);
+}
+
+// a string field of a line: terminated in place if keep is set, only
+//    skipped (and left NULL) otherwise
+static char *dataField(char **pos, char *end, int keep) {
+  if (keep) {
+    return parseCsvString(pos, end);
+  }
+  skipCsvString(pos, end);
+  return NULL;
+}
+
+// parse the fields of a line from suburbName on into data, the strings are
+//    terminated in place, or only checked and skipped if keepStrings is not set
+//    return: NULL, or the message telling the first badly-formatted field
+static char *dataParseFromName(char **pos, char *end, data_t *data, int keepStrings) {
+  data->suburbName = dataField(pos, end, keepStrings);
+  if (!parseInt(pos, end, &data->year)) {
+    return "dataParseLine: error in reading year";
+  }
+  parseSeparator(pos, end);
+  data->stateCode = dataField(pos, end, keepStrings);
+  data->stateName = dataField(pos, end, keepStrings);
+  data->govCode = dataField(pos, end, keepStrings);
+  data->govName = dataField(pos, end, keepStrings);
+  if (!parseDouble(pos, end, &data->latitude) || !parseSeparator(pos, end)
+      || !parseDouble(pos, end, &data->longitude)) {
+    return "dataParseLine: error in reading latitude/longitude";
+  }
+  parseSeparator(pos, end);
+  return NULL;
+}
 
-// read and parse a csv line from file f,
-//    returns pointer to the resulted data record
-//    or NULL if on EOF
-data_t *dataGetLine(FILE *f) {
-  while(1) {
+// read and parse the csv line at *pos of a memory buffer (see arenaMapFile)
+//    returns the resulted data record, or NULL at the end of the buffer
+//    the record is allocated from arena, its strings are terminated in
+//    place and point into the buffer
+data_t *dataParseLine(char **pos, char *end, arena_t *arena) {
+  while (1) {
     int recId;
-    if (fscanf(f, "%d , ", &recId) != 1) {
+    if (!parseInt(pos, end, &recId)) {
       return NULL;   /* return on EOF */
     }
-    data_t *data = myMalloc(sizeof(*data));
+    parseSeparator(pos, end);
+    data_t *data = arenaAlloc(arena, sizeof(*data));
     data->recId = recId;
-    if (fscanf(f, "%d , ", &data->suburbCode) != 1) {
-      //NOTE: all "if"s in this function are for safeguarding data
-      warning("dataGetLine: error in reading suburbCode");
-      fprintf(stderr, "RecID = %d ignored\n", recId);
-      // data not well-formatted, discard the line and try the next one
-      for (int c = fgetc(f); c != '\n' && c != '\r'; c = fgetc(f)){
-        //   ( '\r' is <end-of-line> for some text files )
-      }
-        
-      dataFree(data);
+    data->isArena = TRUE;
+    data->isInterned = FALSE;
+    data->lazy = NULL;
+    if (!parseInt(pos, end, &data->suburbCode)) {
+      dataSkipLine(pos, end, recId, "dataParseLine: error in reading suburbCode");
       continue;
     }
-    data->suburbName = getCsvString(f);
-    if (fscanf(f, "%d , ", &data->year) != 1){
-      warning("dataGetLine: error in reading year");
-      fprintf(stderr, "RecID = %d ignored\n", recId);
-      for (int c = fgetc(f); c != '\n' && c != '\r'; c = fgetc(f)){
-
-      }
-      dataFree(data);
+    parseSeparator(pos, end);
+    char *message = dataParseFromName(pos, end, data, TRUE);
+    if (message) {
+      dataSkipLine(pos, end, recId, message);
       continue;
     }
-    data->stateCode = getCsvString(f);
-    data->stateName = getCsvString(f);
-    data->govCode = getCsvString(f);
-    data->govName = getCsvString(f);
-    if (fscanf(f, "%lf ,%lf ", &data->latitude, &data->longitude) != 2) {
-      warning("dataGetLine: error in reading latitude/longitude");
-      fprintf(stderr, "RecID = %d ignored\n", recId);
-      for (int c = fgetc(f); c != '\n' && c != '\r'; c = fgetc(f)){
+    return data;
+  }
+}
 
-      }
-      dataFree(data);
+// replace the state and gov strings of data by their copies interned in t
+//    (not for lazy records, which are interned when decoded)
+void dataIntern(data_t *data, intern_t *t) {
+  assert(data->lazy == NULL);
+  data->stateCode = internString(t, data->stateCode);
+  data->stateName = internString(t, data->stateName);
+  data->govCode = internString(t, data->govCode);
+  data->govName = internString(t, data->govName);
+  data->isInterned = TRUE;
+}
+
+// return where lazy records of a file mapped by arena decode their rows,
+//    allocated from arena; decoded strings are interned in interns if not NULL
+lazySource_t *dataLazySource(arena_t *arena, intern_t *interns) {
+  // a default mutex holds no resources: it goes with the arena
+  lazySource_t *source = arenaAlloc(arena, sizeof(*source));
+  source->arena = arena;
+  source->interns = interns;
+  pthread_mutex_init(&source->lock, NULL);
+  return source;
+}
+
+// like dataParseLine, but only recId, suburbCode and suburbName are decoded;
+//    the name is copied to arena, and the buffer is left untouched
+//    the rest of the row is only checked, to keep the lines dataParseLine
+//    keeps, and decoded by dataMaterialize()
+data_t *dataParseLazyLine(char **pos, char *end, arena_t *arena, lazySource_t *source) {
+  while (1) {
+    int recId;
+    if (!parseInt(pos, end, &recId)) {
+      return NULL;   /* return on EOF */
+    }
+    parseSeparator(pos, end);
+    data_t *data = arenaAlloc(arena, sizeof(*data));
+    data->recId = recId;
+    data->isArena = TRUE;
+    data->isInterned = FALSE;
+    if (!parseInt(pos, end, &data->suburbCode)) {
+      dataSkipLine(pos, end, recId, "dataParseLine: error in reading suburbCode");
       continue;
+    }
+    parseSeparator(pos, end);
 
+    // the row, from the name on, ends where dataParseLine would stop
+    char *row = *pos;
+    data_t fields;
+    char *message = dataParseFromName(pos, end, &fields, FALSE);
+    if (message) {
+      dataSkipLine(pos, end, recId, message);
+      continue;
     }
+    char *rowEnd = *pos;
+
+    // decode the name from a copy, not to write to the file's pages
+    char name[MAX_BUF_LEN + 1];
+    size_t len = rowEnd - row < MAX_BUF_LEN ? rowEnd - row : MAX_BUF_LEN;
+    memcpy(name, row, len);
+    char *namePos = name;
+    char *s = parseCsvString(&namePos, name + len);
+    data->suburbName = arenaStrdup(arena, s ? s : "", s ? strlen(s) : 0);
+    data->year = 0;
+    data->stateCode = data->stateName = data->govCode = data->govName = NULL;
+    data->latitude = data->longitude = 0;
+
+    data->lazy = source;
+    data->lazyRow = row;
+    data->lazyLen = rowEnd - row;
     return data;
   }
 }
 
+// = 1 if data is a lazy record not decoded yet; once it is decoded, its
+//    fields are read without taking the lock of its source
+static int dataIsLazy(data_t *data) {
+  return data->lazy && __atomic_load_n(&data->lazyRow, __ATOMIC_ACQUIRE) != NULL;
+}
+
+// decode all fields of a lazy record (no-op for other records)
+//    safe to call from several threads
+void dataMaterialize(data_t *data) {
+  if (!dataIsLazy(data)) {
+    return;
+  }
+  lazySource_t *source = data->lazy;
+  pthread_mutex_lock(&source->lock);
+  if (data->lazyRow) {
+    // parse a copy, its strings are terminated in place; interned
+    //    strings are copied, so a short row needs no lasting copy
+    char buf[MAX_BUF_LEN + 1];
+    char *row = buf;
+    if (source->interns == NULL || data->lazyLen > MAX_BUF_LEN) {
+      row = arenaAlloc(source->arena, data->lazyLen + 1);
+    }
+    memcpy(row, data->lazyRow, data->lazyLen);
+    char *pos = row;
+    data_t fields = *data;
+    char *message = dataParseFromName(&pos, row + data->lazyLen, &fields, TRUE);
+    if (message) {
+      // checked at load, so only if the file changed: keep what was decoded
+      warning(message);
+      fprintf(stderr, "RecID = %d decoded partially\n", data->recId);
+    }
+    fields.stateCode = fields.stateCode ? fields.stateCode : "";
+    fields.stateName = fields.stateName ? fields.stateName : "";
+    fields.govCode = fields.govCode ? fields.govCode : "";
+    fields.govName = fields.govName ? fields.govName : "";
+    if (source->interns) {
+      fields.lazy = NULL;
+      dataIntern(&fields, source->interns);
+    }
+    data->year = fields.year;
+    data->stateCode = fields.stateCode;
+    data->stateName = fields.stateName;
+    data->govCode = fields.govCode;
+    data->govName = fields.govName;
+    data->latitude = fields.latitude;
+    data->longitude = fields.longitude;
+    __atomic_store_n(&data->lazyRow, NULL, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&source->lock);
+}
+
+// get the latitude and longitude of data into *latitude and *longitude,
+//    decoding only those of a lazy record, which is left lazy
+//    safe to call from several threads
+void dataGetPosition(data_t *data, double *latitude, double *longitude) {
+  char *row = data->lazy ? __atomic_load_n(&data->lazyRow, __ATOMIC_ACQUIRE) : NULL;
+  if (row) {
+    // the row is read in place: its strings are skipped, not terminated
+    data_t fields;
+    char *pos = row;
+    fields.latitude = fields.longitude = 0;
+    dataParseFromName(&pos, row + data->lazyLen, &fields, FALSE);
+    *latitude = fields.latitude;
+    *longitude = fields.longitude;
+    return;
+  }
+  *latitude = data->latitude;
+  *longitude = data->longitude;
+}
+
 // print a data record to file f, using labels[] as attribute labels
 void dataPrint(void *vdata, char **labels, FILE *f) {
   assert(vdata);
   data_t *data = vdata;
+  fmtbuf_t b;
   int i;
 
+  dataMaterialize(data);
+  fmtInit(&b, f);
   for (i = 0; i < COLS ; i++) {
     if (labels && labels[i]) {
-      fprintf(f, "%s: ", labels[i]);
+      fmtStr(&b, labels[i]);
+      fmtStr(&b, ": ");
     }
     switch (i) {
       case  0: 
-        fprintf(f, "%d, ", data->recId); 
+        fmtInt(&b, data->recId); 
         break;
       case  1: 
-        fprintf(f, "%d, ", data->suburbCode); 
+        fmtInt(&b, data->suburbCode); 
         break;
       case  2: 
-        fprintf(f, "%s, ", data->suburbName); 
+        fmtStr(&b, data->suburbName); 
         break;
       case  3: 
-        fprintf(f, "%d, ", data->year); 
+        fmtInt(&b, data->year); 
         break;
       case  4: 
-        fprintf(f, "%s, ", data->stateCode); 
+        fmtStr(&b, data->stateCode); 
         break;
       case  5: 
-        fprintf(f, "%s, ", data->stateName); 
+        fmtStr(&b, data->stateName); 
         break;
       case  6: 
-        fprintf(f, "%s, ", data->govCode); 
+        fmtStr(&b, data->govCode); 
         break;
       case  7: 
-        fprintf(f, "%s, ", data->govName); 
+        fmtStr(&b, data->govName); 
         break;
       case  8: 
-        fprintf(f, "%.7lf, ", data->latitude); 
+        fmtFixed(&b, data->latitude, 7); 
         break;
       case  9: 
-        fprintf(f, "%.7lf\n", data->longitude); 
+        fmtFixed(&b, data->longitude, 7); 
         break;
     }
+    fmtStr(&b, i < COLS - 1 ? ", " : "\n");
   }
+  fmtFlush(&b);
 }
 
 // free memory associated with "data" pointer
 void dataFree(void *vdata) {
   assert(vdata);
   data_t *data = vdata;
+  if (data->isArena) {
+    return;   // released together with its arena
+  }
   // NOTE: the "if"s are only helpful when cleaning data
   if (data->suburbName) {
     free(data->suburbName);
   }
+  if (data->isInterned) {
+    free(data);
+    return;   // the other strings belong to their intern table
+  }
   if (data->stateCode) {
     free(data->stateCode);
   }
@@ -145,49 +325,49 @@ void dataFree(void *vdata) {
   free(data);
 }
 
-// compare data with a key, counts character comparisons, *8 bits to the bit comparison count
+// compare data with a key, in strcmp() order, adding the bits compared to
+//    *comps, or as fast as strcmp() when comps is NULL
 int dataKeyCmp(void *vdata, void *key, int *comps) {
   data_t *data = vdata;
-  char *s1 = data->suburbName, *s2 = key;
-  int n1 = strlen(s1), n2 = strlen(s2);
+  const unsigned char *s1 = (unsigned char *) data->suburbName;
+  const unsigned char *s2 = key;
 
   if (comps == NULL) {
-    return strcmp(s1, s2);
+    return strcmp((char *) s1, (char *) s2);
   }
 
-  int i = 0;
-  while (i <= n1 && i <= n2) { // <= to include nullbyte
-    (*comps)+= BITS_PER_BYTE; // each character compared adds exactly 8 bits to the bit comparison count
-    if (s1[i] > s2[i]) {
-      return 1;
-    }
-    else if (s1[i] < s2[i]) {
-      return -1;
-    }
+  // characters up to the first different one, or to the nullbyte, are
+  // compared: each adds exactly 8 bits to the bit comparison count
+  size_t i = 0;
+  while (s1[i] == s2[i] && s1[i]) {
     i++;
   }
-
-  return 0;
+  (*comps) += BITS_PER_BYTE * (i + 1);
+  return (s1[i] > s2[i]) - (s1[i] < s2[i]);
 }
 
 // output a data as a CSV line
 void dataCsvOutput(void *v, FILE *f) {
   data_t *data= v;
+  fmtbuf_t b;
   int i;
+
+  dataMaterialize(data);
+  fmtInit(&b, f);
   for (i=0; i<COLS; i++) {
     char *str=NULL;
     switch (i) {
       case  0: 
-        fprintf(f, "%d,", data->recId); 
+        fmtInt(&b, data->recId); 
         break;
       case  1: 
-        fprintf(f, "%d,", data->suburbCode); 
+        fmtInt(&b, data->suburbCode); 
         break;
       case  2: 
         str = data->suburbName; 
         break;
       case  3: 
-        fprintf(f, "%d,", data->year); 
+        fmtInt(&b, data->year); 
         break;
       case  4: 
         str = data->stateCode; 
@@ -202,19 +382,23 @@ void dataCsvOutput(void *v, FILE *f) {
         str = data->govName; 
         break;
       case  8: 
-        fprintf(f, "%.7lf,", data->latitude); 
+        fmtFixed(&b, data->latitude, 7); 
         break;
       case  9: 
-        fprintf(f, "%.7lf\n", data->longitude); 
+        fmtFixed(&b, data->longitude, 7); 
         break;
     }
     if (str) {
       // if a field contains commas, it should start and end with "
       if (strchr(str,',')) {
-        fprintf(f,"\"%s\",", str);
+        fmtChar(&b, '"');
+        fmtStr(&b, str);
+        fmtChar(&b, '"');
       } else {
-        fprintf(f,"%s,", str);
+        fmtStr(&b, str);
       }
     }
+    fmtChar(&b, i < COLS - 1 ? ',' : '\n');
   }
+  fmtFlush(&b);
 }
@@ -12,8 +12,12 @@
 // Specific defs for this data set
 #define COLS 10        // expected number of columms
 
+#include "arena.h"
+#include "intern.h"
+
 typedef struct header header_t;
 typedef struct data data_t;
+typedef struct lazySource lazySource_t;
 
 // struct of CSV records
 struct data {
@@ -27,21 +31,59 @@ struct data {
   char *govName;
   double latitude;
   double longitude;
+  int isArena;         // = 1 if the record and its strings are owned by an arena
+  int isInterned;      // = 1 if the state and gov strings are shared, interned ones
+
+  // a lazy record only has suburbName until dataMaterialize() decodes the
+  //    rest of its row, which starts at lazyRow, from the source file
+  lazySource_t *lazy;  // NULL if all fields are decoded
+  char *lazyRow;       // the row, from suburbName on, NULL once decoded
+  unsigned int lazyLen;
 };
 
-// read and parse the csv header line from file f
-char **dataGetLabels(FILE *f);
+// read and parse the csv header line from the memory buffer at *pos,
+//    advancing *pos to the first data line
+char **dataParseLabels(char **pos, char *end);
+
+// read and parse the csv line at *pos of a memory buffer (see arenaMapFile)
+//    returns the resulted data record, or NULL at the end of the buffer
+//    the record is allocated from arena, its strings are terminated in
+//    place and point into the buffer
+data_t *dataParseLine(char **pos, char *end, arena_t *arena);
+
+// replace the state and gov strings of data by their copies interned in t
+//    (not for lazy records, which are interned when decoded)
+void dataIntern(data_t *data, intern_t *t);
+
+// return where lazy records of a file mapped by arena decode their rows,
+//    allocated from arena; decoded strings are interned in interns if not NULL
+lazySource_t *dataLazySource(arena_t *arena, intern_t *interns);
+
+// like dataParseLine, but only recId, suburbCode and suburbName are decoded;
+//    the name is copied to arena, and the buffer is left untouched
+//    the rest of the row is only checked, to keep the lines dataParseLine
+//    keeps, and decoded by dataMaterialize()
+data_t *dataParseLazyLine(char **pos, char *end, arena_t *arena, lazySource_t *source);
+
+// decode all fields of a lazy record (no-op for other records)
+//    safe to call from several threads
+void dataMaterialize(data_t *data);
 
-// read and parse a csv line from file f, returns the resulted data record
-data_t *dataGetLine(FILE *f);
+// get the latitude and longitude of data into *latitude and *longitude,
+//    decoding only those of a lazy record, which is left lazy
+//    safe to call from several threads
+void dataGetPosition(data_t *data, double *latitude, double *longitude);
 
 // print a data record to file f, using labels[] as attribute labels
 void dataPrint(void *data, char **labels, FILE *f);
 
 // free memory associated with "data" pointer
+//    (no-op for records owned by an arena, interned strings are left to
+//    their table)
 void dataFree(void *data);
 
-// compare data with a key
+// compare data with a key, in strcmp() order, adding the bits compared to
+//    *comps, or as fast as strcmp() when comps is NULL
 int dataKeyCmp(void *data, void *key, int *comps);
 
 // output a data as a CSV line
@@ -13,21 +13,29 @@
 #include <assert.h>
 #include "utils.h"
 #include "dict.h"
-#include "linkedList.h"        // supporting concrete data structure
-
-/* NOTE: current version is only working with linked list */
+#include "linkedList.h"        // supporting concrete data structures
+#include "hashTable.h"
+#include "patricia_trie.h"
+#include "keyset.h"
+#include "format.h"
 
 struct dict {
   concreteDS_t dsType;    // Underlying data structure
   char **labels;          // NULL-terminated sequence of data column labels
   void *coll;	            // data structure holding all records of the collection
 	int isMain;             // = 1 if this is the main dict that holds actual data
+  arena_t *arena;         // arena owning the records of a main dict, or NULL
+  qcache_t *cache;        // query results to drop on deletion, or NULL
+  intern_t *interns;      // table of the interned strings of records, or NULL
 
   // function pointers for operations with sepific data structure
   //     to create, free, and modify the coresponding collection
   void *((*create)(void));  // create empty collection
   int (*insert)(void *coll, void *data);  // insert 1 data into coll
   int (*delete)(void *coll, void *key);   // delete all keys from coll
+  int (*deleteIf)(void *coll, int (*hit)(void *data, void *arg), void *arg);
+                          // delete all records hit in one pass, or NULL
+                          //     if deleting key by key is as fast
   int (*search)(void *key, void *sourceColl, void *targetColl, comparison_info_t *compare_info);
                           // search for key in sourceColl
                           // append found records to targetColl
@@ -41,6 +49,85 @@ struct dict {
 // build new empty dict with the same structure as "template"
 dict_t *dictCreateFromTemplate(dict_t *template);
 
+// keys of a batch deletion and the records each removed, for batchHit()
+typedef struct batch {
+  keyset_t *keys;
+  int *removals;          // by key number in keys
+} batch_t;
+
+// = 1 if data has one of the keys of a batch, counting it for that key
+static int batchHit(void *vdata, void *vbatch) {
+  batch_t *batch = vbatch;
+  int id = keysetFind(batch->keys, ((data_t *) vdata)->suburbName);
+  if (id < 0) {
+    return FALSE;
+  }
+  batch->removals[id]++;
+  return TRUE;
+}
+
+// collection operations on a patricia trie, keyed by suburb name
+static void *trieCreate(void) {
+  return create_patricia();
+}
+
+static int trieInsert(void *trie, void *data) {
+  insert_patricia(trie, ((data_t *) data)->suburbName, data);
+  return 1;
+}
+
+static int trieDelete(void *trie, void *key) {
+  return delete_patricia(trie, key, dataFree);
+}
+
+static int trieSearch(void *key, void *source, void *target,
+                      comparison_info_t *compare_info) {
+  patricia_trie_t *trie = source;
+  uint32_t matches;
+  uint32_t found = find_patricia(trie, key, &matches, compare_info);
+  for (uint32_t i = 0; i < matches; i++) {
+    trieInsert(target, trie->records[found + i]);
+  }
+  return matches;
+}
+
+// where trie records are printed, for walk_patricia()
+typedef struct trieOutput {
+  char **labels;          // NULL for csv output
+  FILE *f;
+} trieOutput_t;
+
+static void trieOutputRecord(data_t *data, void *vout) {
+  trieOutput_t *out = vout;
+  if (out->labels) {
+    dataPrint(data, out->labels, out->f);
+  } else {
+    dataCsvOutput(data, out->f);
+  }
+}
+
+static void triePrint(void *trie, char **labels, FILE *f) {
+  trieOutput_t out = {labels, f};
+  walk_patricia(trie, trieOutputRecord, &out);
+}
+
+static void trieCsvOutput(void *trie, FILE *f) {
+  trieOutput_t out = {NULL, f};
+  walk_patricia(trie, trieOutputRecord, &out);
+}
+
+static void trieFreeRecord(data_t *data, void *vdataFree) {
+  void (*dataFree)(void *) = *(void (**)(void *)) vdataFree;
+  dataFree(data);
+}
+
+static void trieFree(void *trie, void (*dataFree)(void *data)) {
+  if (dataFree) {
+    walk_patricia(trie, trieFreeRecord, &dataFree);
+  }
+  free_all_patricia(trie);
+}
+
 
 /*----- implementation of all funtions -----*/
 
@@ -50,6 +137,9 @@ dict_t *dictCreate(concreteDS_t dsType, int isMain, char **labels) {
   dict->dsType = dsType;
   dict->labels = labels;
   dict->isMain = isMain;
+  dict->arena = NULL;
+  dict->cache = NULL;
+  dict->interns = NULL;
 
   // bind operations
   switch(dsType) {
@@ -58,10 +148,31 @@ dict_t *dictCreate(concreteDS_t dsType, int isMain, char **labels) {
       dict->insert = llistInsert;
       dict->search = llistSearch;
       dict->delete = llistDelete;
+      dict->deleteIf = llistDeleteIf;
       dict->print = llistPrint;
       dict->free = llistFree;
       dict->csvOutput = llistCsvOutput;
       break;
+    case HASH_TABLE:
+      dict->create = htCreate;
+      dict->insert = htInsert;
+      dict->search = htSearch;
+      dict->delete = htDelete;
+      dict->deleteIf = NULL;
+      dict->print = htPrint;
+      dict->free = htFree;
+      dict->csvOutput = htCsvOutput;
+      break;
+    case PATRICIA_TRIE:
+      dict->create = trieCreate;
+      dict->insert = trieInsert;
+      dict->search = trieSearch;
+      dict->delete = trieDelete;
+      dict->deleteIf = NULL;
+      dict->print = triePrint;
+      dict->free = trieFree;
+      dict->csvOutput = trieCsvOutput;
+      break;
     default:
       error("dictCreate: Required data structure not yet implemented");
   }
@@ -73,6 +184,11 @@ dict_t *dictCreate(concreteDS_t dsType, int isMain, char **labels) {
 }
 
 
+// NULL-terminated sequence of data column labels of dict
+char **dictLabels(dict_t *dict) {
+  return dict->labels;
+}
+
 // print whole dict
 void dictPrint(dict_t *dict, FILE *f) {
   assert(dict && f && dict->coll);
@@ -89,7 +205,12 @@ void dictFree(dict_t *dict) {
       free(dict->labels);
     }
     if (dict->coll) {
-      dict->free(dict->coll, dataFree);
+      // arena-owned records are released with their blocks, not one by one
+      dict->free(dict->coll, dict->arena ? NULL : dataFree);
+    }
+    internFree(dict->interns);   // after the records sharing its strings
+    if (dict->arena) {
+      arenaFree(dict->arena);
     }
   } else {
     if (dict->coll) {
@@ -99,6 +220,32 @@ void dictFree(dict_t *dict) {
   free(dict);
 }
 
+// hand over to a main dict the arena that its records are allocated from,
+//    the arena is freed by dictFree()
+void dictAdoptArena(dict_t *dict, arena_t *arena) {
+  assert(dict->isMain && !dict->arena);
+  dict->arena = arena;
+}
+
+// hand over to a main dict the table interning the strings of its records,
+//    the table is freed by dictFree()
+void dictAdoptInterns(dict_t *dict, intern_t *interns) {
+  assert(dict->isMain && !dict->interns);
+  dict->interns = interns;
+}
+
+// the table interning the strings of the records of dict, or NULL
+//    equal interned strings are the same pointer, see internLookup()
+intern_t *dictInterns(dict_t *dict) {
+  return dict->interns;
+}
+
+// attach to dict a cache of query results, cleared whenever dictDelete()
+//    removes records; the cache is still owned by the caller
+void dictAttachCache(dict_t *dict, qcache_t *cache) {
+  dict->cache = cache;
+}
+
 // insert, search, deletion in  dictionary, returning SUCSESS/FAILURE
 //        returning the number of inserted records
 int dictInsert(dict_t *dict, void *data) {
@@ -108,7 +255,52 @@ int dictInsert(dict_t *dict, void *data) {
 // remove from dict all records that have "key",
 //        returning the mnuber of removed records
 int dictDelete(dict_t *dict, void *key) {
-  return dict->delete(dict->coll, key);
+  int removals = dict->delete(dict->coll, key);
+  if (removals && dict->cache) {
+    qcacheClear(dict->cache);
+  }
+  return removals;
+}
+
+// remove from dict all records that have any of keys[0..n-1], as if each
+//     key was deleted in turn by dictDelete(), but in one pass over a
+//     list; removals[i] is set to the number of records removed by keys[i]
+//     return total number of records removed
+int dictDeleteBatch(dict_t *dict, char **keys, int n, int *removals) {
+  int total = 0;
+  if (dict->deleteIf == NULL) {
+    for (int i = 0; i < n; i++) {
+      removals[i] = dictDelete(dict, keys[i]);
+      total += removals[i];
+    }
+    return total;
+  }
+
+  // number the distinct keys, a repeated key removes nothing more
+  batch_t batch;
+  batch.keys = keysetCreate(n);
+  batch.removals = myCalloc(n > 0 ? n : 1, sizeof(*batch.removals));
+  int *first = myMalloc((n > 0 ? n : 1) * sizeof(*first));   // key number -> i
+  for (int i = 0; i < n; i++) {
+    int seen = keysetCount(batch.keys);
+    int id = keysetAdd(batch.keys, keys[i]);
+    if (id == seen) {       // a new key
+      first[id] = i;
+    }
+    removals[i] = 0;
+  }
+
+  total = dict->deleteIf(dict->coll, batchHit, &batch);
+  for (int id = 0; id < keysetCount(batch.keys); id++) {
+    removals[first[id]] = batch.removals[id];
+  }
+  if (total && dict->cache) {
+    qcacheClear(dict->cache);
+  }
+  free(first);
+  free(batch.removals);
+  keysetFree(batch.keys);
+  return total;
 }
 
 // search for (possibly duplicated) key in dictinary,
@@ -124,6 +316,9 @@ dict_t *dictCopyStructure(dict_t *dict) {
   dict_t *copy = myMalloc(sizeof(*dict));
   *copy = *dict;
   copy->isMain = FALSE;
+  copy->arena = NULL;
+  copy->cache = NULL;
+  copy->interns = NULL;
   copy->coll = copy->create();
   return copy;
 }
@@ -132,6 +327,7 @@ dict_t *dictCopyStructure(dict_t *dict) {
 // write dictionary to a file in the CSV format
 void dictOutputCsvFile(dict_t *dict, char *fname) {
   FILE *f = myFopen(fname, "w");
+  char *buf = fmtFileBuffer(f);
   for (int i = 0; dict->labels[i]; i++) {
     fprintf(f, "%s", dict->labels[i]);
     if (dict->labels[i + 1]) {
@@ -142,4 +338,5 @@ void dictOutputCsvFile(dict_t *dict, char *fname) {
   }
   dict->csvOutput(dict->coll, f);
   fclose(f);
+  free(buf);
 }
@@ -11,11 +11,14 @@
 #define _DICT_H_
 
 #include "comparison_info.h"
+#include "qcache.h"
 
 // common defs for all dict
 typedef enum {
   LOWER_BOUND = 0, 
   LINKED_LIST = 1, 
+  HASH_TABLE,
+  PATRICIA_TRIE,          // lists its records by name
   // By default, enum values take the value preceeding
   //  plus one.
   UPPER_BOUND
@@ -29,12 +32,31 @@ dict_t *dictCreate(concreteDS_t dsType, int isMain, char **labels);
 // return an empty dict with the same structure
 dict_t *dictCopyStructure(dict_t *dict);
 
+// NULL-terminated sequence of data column labels of dict
+char **dictLabels(dict_t *dict);
+
 // print whole dict
 void dictPrint(dict_t *dict, FILE *f);
 
 // free all memory of dict, including data memory if isMain is true
 void dictFree(dict_t *dict);
 
+// hand over to a main dict the arena that its records are allocated from,
+//    the arena is freed by dictFree()
+void dictAdoptArena(dict_t *dict, arena_t *arena);
+
+// hand over to a main dict the table interning the strings of its records,
+//    the table is freed by dictFree()
+void dictAdoptInterns(dict_t *dict, intern_t *interns);
+
+// the table interning the strings of the records of dict, or NULL
+//    equal interned strings are the same pointer, see internLookup()
+intern_t *dictInterns(dict_t *dict);
+
+// attach to dict a cache of query results, cleared whenever dictDelete()
+//    removes records; the cache is still owned by the caller
+void dictAttachCache(dict_t *dict, qcache_t *cache);
+
 // insert a single data to dict,
 //     return number of records inserted (1 or 0)
 int dictInsert(dict_t *dict, void *data);
@@ -43,6 +65,12 @@ int dictInsert(dict_t *dict, void *data);
 //     return number of records removed
 int dictDelete(dict_t *dict, void *key);
 
+// remove from dict all records that have any of keys[0..n-1], as if each
+//     key was deleted in turn by dictDelete(), but in one pass over a
+//     list; removals[i] is set to the number of records removed by keys[i]
+//     return total number of records removed
+int dictDeleteBatch(dict_t *dict, char **keys, int n, int *removals);
+
 // search for (possibly duplicated) key in dictinary,
 //     append found records to file "result"
 //     return the number of found record
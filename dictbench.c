@@ -0,0 +1,317 @@
+/*
+   dictbench.c: benchmark of loading a dataset, building each dictionary
+      structure and running queries on it (see "make bench")
+   Usage: dictbench data.csv queries.in results.csv [threads]
+   One csv line per measurement is appended to results.csv (with a header
+      line if the file is empty):
+      rows,structure,task,phase,count,total_ms,p50_us,p99_us,per_sec
+   where count is what per_sec counts (rows loaded or inserted, queries or
+      deleted keys), and p50/p99 are per-query latencies, left empty for
+      phases that are not made of queries.
+   Tasks 7 and 8 query points next to records instead of the names.
+   The "scan" structure answers task 4 without an index, scoring every
+      distinct name in one batch: the baseline of the trie's closest search.
+   Searches run their fast variants, which do not count comparisons.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "utils.h"
+#include "arena.h"
+#include "loader.h"
+#include "dict.h"
+#include "keysort.h"
+#include "patricia_trie.h"
+#include "kdtree.h"
+#include "editdist.h"
+
+#define QUERY_BUDGET 2.0      // seconds of queries per structure and task
+#define MIN_QUERIES 20        // queries run at least, whatever the budget
+#define TOPK 5                // names listed by the task 5 queries
+#define PREFIX_LIMIT 10       // records listed by the task 6 queries
+#define RADIUS_KM 10.0        // distance of the task 8 queries
+
+// a dataset and the queries run on it
+typedef struct bench {
+  size_t rows;
+  char **queries;
+  int nQueries;
+  double *latency;            // seconds, of each query run
+  FILE *out;
+} bench_t;
+
+// the distinct names of a dataset, for a closest search without an index
+typedef struct scan {
+  char **names;
+  int nNames;
+  int *distances;             // of each name to the query
+} scan_t;
+
+// a query of a task on one structure
+typedef void (*benchQuery_t)(char *query, void *arg);
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// seconds on a monotonic clock
+static double now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int cmpDouble(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+// the q-quantile of sorted[0..n-1], by nearest rank
+static double quantile(double *sorted, int n, double q) {
+  int rank = (int) ceil(q * n);
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// write a measurement of a phase made of one block of work
+static void report(bench_t *b, char *structure, char *task, char *phase,
+                   size_t count, double seconds) {
+  fprintf(b->out, "%zu,%s,%s,%s,%zu,%.3f,,,%.0f\n", b->rows, structure, task,
+          phase, count, seconds * 1e3, seconds > 0 ? count / seconds : 0);
+}
+
+// run the queries one by one, within the time budget, and report them
+static void runQueries(bench_t *b, char *structure, char *task,
+                       benchQuery_t query, void *arg) {
+  double start = now(), total = 0;
+  int n = 0;
+  while (n < b->nQueries && (n < MIN_QUERIES || now() - start < QUERY_BUDGET)) {
+    double t = now();
+    query(b->queries[n], arg);
+    b->latency[n] = now() - t;
+    total += b->latency[n++];
+  }
+  if (n == 0) {
+    return;
+  }
+  qsort(b->latency, n, sizeof(*b->latency), cmpDouble);
+  fprintf(b->out, "%zu,%s,%s,query,%d,%.3f,%.3f,%.3f,%.0f\n", b->rows, structure,
+          task, n, total * 1e3, quantile(b->latency, n, 0.5) * 1e6,
+          quantile(b->latency, n, 0.99) * 1e6, total > 0 ? n / total : 0);
+}
+
+// task 3: find all records of a name in a dict
+static void dictQuery(char *query, void *vdict) {
+  dict_t *result = dictCopyStructure(vdict);
+  dictSearch(query, vdict, result, NULL);
+  dictFree(result);
+}
+
+// task 4: the records of a name, or of the closest name
+static void trieQuery(char *query, void *trie) {
+  uint32_t matches;
+  search_patricia(trie, query, &matches, NULL);
+}
+
+// task 4 without an index: the closest name, by scoring them all
+static void scanQuery(char *query, void *vscan) {
+  scan_t *scan = vscan;
+  edpattern_t *pattern = edPatternCreate(query, strlen(query));
+  edPatternBatch(pattern, scan->names, scan->nNames, scan->distances);
+  edPatternFree(pattern);
+  int closest = 0;
+  for (int i = 1; i < scan->nNames; i++) {
+    if (scan->distances[i] < scan->distances[closest]) {
+      closest = i;            // names are sorted: ties go to the earliest
+    }
+  }
+}
+
+// task 5: the closest names
+static void topkQuery(char *query, void *trie) {
+  patricia_match_t matches[TOPK];
+  topk_patricia(trie, query, TOPK, matches, NULL);
+}
+
+// count the records streamed by a prefix query
+static void countRecord(uint32_t record, void *count) {
+  (void) record;
+  (*(uint32_t *) count)++;
+}
+
+// task 6: the first records of the names starting with the query
+static void prefixQuery(char *query, void *trie) {
+  uint32_t count = 0;
+  prefix_patricia(trie, query, PREFIX_LIMIT, countRecord, &count, NULL);
+}
+
+// task 7: the records nearest to a point, "latitude longitude"
+static void nearestQuery(char *query, void *kd) {
+  char *end;
+  double latitude = strtod(query, &end);
+  double longitude = strtod(end, NULL);
+  kdMatch_t matches[TOPK];
+  kdtreeNearest(kd, latitude, longitude, TOPK, matches, NULL);
+}
+
+// task 8: the records within RADIUS_KM of a point
+static void radiusQuery(char *query, void *kd) {
+  char *end;
+  double latitude = strtod(query, &end);
+  double longitude = strtod(end, NULL);
+  kdMatch_t *matches;
+  kdtreeWithin(kd, latitude, longitude, RADIUS_KM, 0, &matches, NULL);
+  free(matches);
+}
+
+// *n point queries, each a little off a record spread over records[],
+//    none if there are no records (*n is then set to 0)
+static char **pointQueries(data_t **records, size_t rows, int *n) {
+  if (rows == 0) {
+    *n = 0;
+  }
+  char **queries = myMalloc((*n ? *n : 1) * sizeof(*queries));
+  char buf[MAX_STR_LEN + 1];
+  for (int i = 0; i < *n; i++) {
+    data_t *data = records[(i * 2654435761u) % rows];
+    snprintf(buf, sizeof(buf), "%.6f %.6f", data->latitude + 0.01, data->longitude - 0.01);
+    queries[i] = myStrdup(buf);
+  }
+  return queries;
+}
+
+// build a dict of type dsType from records, run tasks 3 then 2 on it
+static void benchDict(bench_t *b, concreteDS_t dsType, char *structure,
+                      data_t **records, char **labels) {
+  dict_t *dict = dictCreate(dsType, FALSE, labels);
+  double t = now();
+  for (size_t i = 0; i < b->rows; i++) {
+    dictInsert(dict, records[i]);
+  }
+  report(b, structure, "3", "build", b->rows, now() - t);
+  runQueries(b, structure, "3", dictQuery, dict);
+
+  int *removals = myMalloc(b->nQueries * sizeof(*removals));
+  t = now();
+  dictDeleteBatch(dict, b->queries, b->nQueries, removals);
+  report(b, structure, "2", "delete", b->nQueries, now() - t);
+  free(removals);
+  dictFree(dict);
+}
+
+// read all lines of file fname
+static char **readQueries(char *fname, int *n) {
+  FILE *f = myFopen(fname, "r");
+  char **queries = NULL;
+  int size = 0;
+  char *query;
+  *n = 0;
+  while ((query = getString(f)) != NULL) {
+    if (*n == size) {
+      size = size ? 2 * size : 1024;
+      queries = myRealloc(queries, size * sizeof(*queries));
+    }
+    queries[(*n)++] = query;
+  }
+  fclose(f);
+  return queries;
+}
+
+
+int main(int argc, char *argv[]) {
+  if (argc < 4 || argc > 5) {
+    fprintf(stderr, "Usage: %s data.csv queries.in results.csv [threads]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  int nThreads = argc == 5 ? strtol(argv[4], NULL, 10) : 1;
+  if (nThreads < 1) {
+    error("dictbench: threads must be positive");
+  }
+  bench_t b;
+  b.queries = readQueries(argv[2], &b.nQueries);
+  b.latency = myMalloc((b.nQueries ? b.nQueries : 1) * sizeof(*b.latency));
+  b.out = myFopen(argv[3], "a");
+  if (ftell(b.out) == 0) {
+    fprintf(b.out, "rows,structure,task,phase,count,total_ms,p50_us,p99_us,per_sec\n");
+  }
+
+  // load, as tasks 2-5 do
+  double t = now();
+  arena_t *arena = arenaCreate(ARENA_BLOCK_SIZE);
+  size_t size;
+  char *pos = arenaMapFile(arena, argv[1], &size);
+  char *end = pos + size;
+  char **labels = dataParseLabels(&pos, end);
+  intern_t *interns = internCreate();
+  data_t **records = loadRecords(pos, end, arena, nThreads, FALSE, interns, &b.rows);
+  report(&b, "csv", "-", "load", b.rows, now() - t);
+
+  benchDict(&b, LINKED_LIST, "list", records, labels);
+  benchDict(&b, HASH_TABLE, "hash", records, labels);
+  benchDict(&b, PATRICIA_TRIE, "trie", records, labels);
+
+  // tasks 4-6 on a trie built from sorted names
+  t = now();
+  keyed_t *sorted = myMalloc((b.rows ? b.rows : 1) * sizeof(*sorted));
+  for (size_t i = 0; i < b.rows; i++) {
+    sorted[i].key = records[i]->suburbName;
+    sorted[i].item = records[i];
+  }
+  keySort(sorted, b.rows, nThreads);
+  patricia_trie_t *trie = create_patricia();
+  bulk_patricia(trie, sorted, b.rows);
+  layout_patricia(trie);
+  report(&b, "patricia", "4", "build", b.rows, now() - t);
+  runQueries(&b, "patricia", "4", trieQuery, trie);
+  runQueries(&b, "patricia", "5", topkQuery, trie);
+  runQueries(&b, "patricia", "6", prefixQuery, trie);
+  free_all_patricia(trie);
+
+  // task 4 again, on the sorted distinct names alone
+  scan_t scan;
+  scan.names = myMalloc((b.rows ? b.rows : 1) * sizeof(*scan.names));
+  scan.nNames = 0;
+  for (size_t i = 0; i < b.rows; i++) {
+    if (i == 0 || strcmp(sorted[i].key, sorted[i - 1].key) != 0) {
+      scan.names[scan.nNames++] = ((data_t *) sorted[i].item)->suburbName;
+    }
+  }
+  scan.distances = myMalloc((scan.nNames ? scan.nNames : 1) * sizeof(*scan.distances));
+  if (scan.nNames > 0) {
+    runQueries(&b, "scan", "4", scanQuery, &scan);
+  }
+  free(scan.names);
+  free(scan.distances);
+  free(sorted);
+
+  // tasks 7 and 8 on a k-d tree, with point queries
+  t = now();
+  kdtree_t *kd = kdtreeCreate(records, b.rows);
+  report(&b, "kdtree", "7", "build", b.rows, now() - t);
+  char **names = b.queries;
+  int nNames = b.nQueries;
+  b.queries = pointQueries(records, b.rows, &b.nQueries);
+  runQueries(&b, "kdtree", "7", nearestQuery, kd);
+  runQueries(&b, "kdtree", "8", radiusQuery, kd);
+  for (int i = 0; i < b.nQueries; i++) {
+    free(b.queries[i]);
+  }
+  free(b.queries);
+  b.queries = names;
+  b.nQueries = nNames;
+  kdtreeFree(kd);
+
+  for (int i = 0; labels[i]; i++) {
+    free(labels[i]);
+  }
+  free(labels);
+  free(records);
+  internFree(interns);
+  arenaFree(arena);
+  for (int i = 0; i < b.nQueries; i++) {
+    free(b.queries[i]);
+  }
+  free(b.queries);
+  free(b.latency);
+  fclose(b.out);
+  return 0;
+}
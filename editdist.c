@@ -0,0 +1,198 @@
+/*
+   editdist.c, .h: module computing Levenshtein distances with the
+      bit-vector algorithm of Myers (as formulated by Hyyro): one column of
+      the distance table is updated 64 rows at a time, patterns of up to 64
+      characters fit in a single word, longer ones are split in blocks
+   The text is fed one character at a time, so that texts sharing a prefix,
+      like the names below a patricia trie node, share its columns.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "utils.h"
+#include "editdist.h"
+
+#define WORD_BITS 64
+#define ALPHABET 256
+
+struct edpattern {
+  int len;              // pattern length
+  int nBlocks;          // number of 64-row blocks
+  uint64_t *peq;        // peq[c * nBlocks + b]: rows of block b holding c
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// advance the vertical deltas (*pv, *mv) of one block by one text
+//    character with match vector eq, hin being the horizontal delta
+//    entering the block from above; return the horizontal delta leaving
+//    the block at row bit "out"
+static inline int advanceBlock(uint64_t *pv, uint64_t *mv, uint64_t eq, int hin,
+                               uint64_t out) {
+  uint64_t xv = eq | *mv;
+  if (hin < 0) {
+    eq |= 1;
+  }
+  uint64_t xh = (((eq & *pv) + *pv) ^ *pv) | eq;
+  uint64_t ph = *mv | ~(xh | *pv);
+  uint64_t mh = *pv & xh;
+
+  int hout = 0;
+  if (ph & out) {
+    hout = 1;
+  } else if (mh & out) {
+    hout = -1;
+  }
+
+  ph <<= 1;
+  mh <<= 1;
+  if (hin < 0) {
+    mh |= 1;
+  } else if (hin > 0) {
+    ph |= 1;
+  }
+  *pv = mh | ~(xv | ph);
+  *mv = ph & xv;
+  return hout;
+}
+
+// distance for a pattern of m <= 64 characters with match vectors peq[c]
+static int singleWord(const uint64_t *peq, int m, const char *text, int n) {
+  uint64_t pv = ~(uint64_t) 0, mv = 0;
+  uint64_t out = (uint64_t) 1 << (m - 1);
+  int score = m;
+  for (int j = 0; j < n; j++) {
+    // the top row grows by one per column: a +1 enters from above
+    score += advanceBlock(&pv, &mv, peq[(unsigned char) text[j]], 1, out);
+  }
+  return score;
+}
+
+// distance for a pattern split in nBlocks blocks, peq[c * nBlocks + b]
+static int blocked(const uint64_t *peq, int m, int nBlocks, const char *text, int n) {
+  uint64_t *pv = myMalloc(nBlocks * sizeof(*pv));
+  uint64_t *mv = myMalloc(nBlocks * sizeof(*mv));
+  for (int b = 0; b < nBlocks; b++) {
+    pv[b] = ~(uint64_t) 0;
+    mv[b] = 0;
+  }
+  // rows after the last pattern character only feed rows below them,
+  //    so the padding of the last block is harmless
+  uint64_t high = (uint64_t) 1 << (WORD_BITS - 1);
+  uint64_t last = (uint64_t) 1 << ((m - 1) % WORD_BITS);
+  int score = m;
+  for (int j = 0; j < n; j++) {
+    const uint64_t *eq = peq + (unsigned char) text[j] * nBlocks;
+    int h = 1;
+    for (int b = 0; b < nBlocks; b++) {
+      h = advanceBlock(&pv[b], &mv[b], eq[b], h, b == nBlocks - 1 ? last : high);
+    }
+    score += h;
+  }
+  free(pv);
+  free(mv);
+  return score;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// preprocess pattern pat of length m, to be compared with many texts
+edpattern_t *edPatternCreate(const char *pat, int m) {
+  assert(m >= 0 && (pat || m == 0));
+  edpattern_t *p = myMalloc(sizeof(*p));
+  p->len = m;
+  p->nBlocks = m > 0 ? (m + WORD_BITS - 1) / WORD_BITS : 1;
+  p->peq = myCalloc((size_t) ALPHABET * p->nBlocks, sizeof(*p->peq));
+  for (int i = 0; i < m; i++) {
+    p->peq[(unsigned char) pat[i] * p->nBlocks + i / WORD_BITS] |=
+      (uint64_t) 1 << (i % WORD_BITS);
+  }
+  return p;
+}
+
+// edit distance between the pattern and text of length n
+int edPatternDistance(const edpattern_t *p, const char *text, int n) {
+  assert(p && n >= 0 && (text || n == 0));
+  if (p->len == 0) {
+    return n;
+  }
+  if (p->nBlocks == 1) {
+    return singleWord(p->peq, p->len, text, n);
+  }
+  return blocked(p->peq, p->len, p->nBlocks, text, n);
+}
+
+// score the pattern against the nTexts strings of texts[],
+//    distances[i] is set to the edit distance to texts[i]
+void edPatternBatch(const edpattern_t *p, char **texts, int nTexts, int *distances) {
+  assert(p && (texts || nTexts == 0) && (distances || nTexts == 0));
+  for (int i = 0; i < nTexts; i++) {
+    distances[i] = edPatternDistance(p, texts[i], strlen(texts[i]));
+  }
+}
+
+// number of words of pv[] and mv[]
+int edPatternWords(const edpattern_t *p) {
+  return p->nBlocks;
+}
+
+// the column of the empty text, D[i] = i
+void edColumnStart(const edpattern_t *p, uint64_t *pv, uint64_t *mv) {
+  for (int b = 0; b < p->nBlocks; b++) {
+    pv[b] = ~(uint64_t) 0;
+    mv[b] = 0;
+  }
+}
+
+// extend the text of column (pv, mv) by character c, into (npv, nmv)
+//    return: the change of the distance to the whole pattern, D[m]
+int edColumnStep(const edpattern_t *p, const uint64_t *pv, const uint64_t *mv, char c,
+                 uint64_t *npv, uint64_t *nmv) {
+  memcpy(npv, pv, p->nBlocks * sizeof(*npv));
+  memcpy(nmv, mv, p->nBlocks * sizeof(*nmv));
+  if (p->len == 0) {
+    return 1;     // D[0] is the text length
+  }
+  const uint64_t *eq = p->peq + (unsigned char) c * p->nBlocks;
+  uint64_t last = (uint64_t) 1 << ((p->len - 1) % WORD_BITS);
+  if (p->nBlocks == 1) {
+    return advanceBlock(npv, nmv, eq[0], 1, last);
+  }
+  uint64_t high = (uint64_t) 1 << (WORD_BITS - 1);
+  int h = 1;
+  for (int b = 0; b < p->nBlocks; b++) {
+    h = advanceBlock(&npv[b], &nmv[b], eq[b], h, b == p->nBlocks - 1 ? last : high);
+  }
+  return h;
+}
+
+// smallest entry of column (pv, mv) whose D[0] is top
+int edColumnMin(const edpattern_t *p, const uint64_t *pv, const uint64_t *mv, int top) {
+  int d = top, lowest = top;
+  for (int b = 0; b * WORD_BITS < p->len; b++) {
+    int rows = p->len - b * WORD_BITS < WORD_BITS ? p->len - b * WORD_BITS : WORD_BITS;
+    uint64_t up = pv[b], down = mv[b];
+    for (int i = 0; i < rows; i++, up >>= 1, down >>= 1) {
+      if (down == 0) {
+        d += __builtin_popcountll(up);    // no lower entry in this block
+        break;
+      }
+      d += (int) (up & 1) - (int) (down & 1);
+      if (d < lowest) {
+        lowest = d;
+      }
+    }
+  }
+  return lowest;
+}
+
+// free a pattern
+void edPatternFree(edpattern_t *p) {
+  if (p) {
+    free(p->peq);
+    free(p);
+  }
+}
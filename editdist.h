@@ -0,0 +1,48 @@
+/*
+   editdist.c, .h: module computing Levenshtein distances with the
+      bit-vector algorithm of Myers (as formulated by Hyyro): one column of
+      the distance table is updated 64 rows at a time, patterns of up to 64
+      characters fit in a single word, longer ones are split in blocks
+   The text is fed one character at a time, so that texts sharing a prefix,
+      like the names below a patricia trie node, share its columns.
+*/
+
+#ifndef _EDITDIST_H_
+#define _EDITDIST_H_
+
+#include <stdint.h>
+
+typedef struct edpattern edpattern_t;
+
+// preprocess pattern pat of length m, to be compared with many texts
+edpattern_t *edPatternCreate(const char *pat, int m);
+
+// edit distance between the pattern and text of length n
+int edPatternDistance(const edpattern_t *p, const char *text, int n);
+
+// score the pattern against the nTexts strings of texts[],
+//    distances[i] is set to the edit distance to texts[i]
+void edPatternBatch(const edpattern_t *p, char **texts, int nTexts, int *distances);
+
+// a column of the distance table between the pattern and a text, D[i] for
+//    each pattern prefix of i characters, is kept as its vertical deltas
+//    D[i] - D[i-1]: bits of pv[] are +1, of mv[] -1, edPatternWords() words each
+
+// number of words of pv[] and mv[]
+int edPatternWords(const edpattern_t *p);
+
+// the column of the empty text, D[i] = i
+void edColumnStart(const edpattern_t *p, uint64_t *pv, uint64_t *mv);
+
+// extend the text of column (pv, mv) by character c, into (npv, nmv)
+//    return: the change of the distance to the whole pattern, D[m]
+int edColumnStep(const edpattern_t *p, const uint64_t *pv, const uint64_t *mv, char c,
+                 uint64_t *npv, uint64_t *nmv);
+
+// smallest entry of column (pv, mv) whose D[0] is top
+int edColumnMin(const edpattern_t *p, const uint64_t *pv, const uint64_t *mv, int top);
+
+// free a pattern
+void edPatternFree(edpattern_t *p);
+
+#endif
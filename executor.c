@@ -0,0 +1,209 @@
+/*
+   executor.c, .h: module for running read-only queries as a pipeline:
+      a reader thread feeds a bounded ring of queries to search threads,
+      and a writer outputs their results in input order
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "executor.h"
+
+// queries between the reader and the writer: the reader waits when the
+//    writer is this far behind
+#define RING_SIZE 1024
+
+// output is written in pieces of this size
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+// a query and the text it produced
+typedef struct job {
+  char *query;
+  char *out, *msg;          // buffered output
+  size_t outLen, msgLen;
+  int done;                 // = 1 once searched
+} job_t;
+
+// everything shared by the stages, job i is in ring[i % RING_SIZE]
+typedef struct pipeline {
+  job_t *ring;
+  size_t nRead;             // queries read
+  size_t nTaken;            // queries given to search threads
+  size_t nWritten;          // queries written
+  int eof;                  // = 1 once all queries are read
+  pthread_mutex_t lock;
+  pthread_cond_t notFull;   // the reader waits for the writer
+  pthread_cond_t ready;     // search threads wait for the reader
+  pthread_cond_t done;      // the writer waits for search threads
+  FILE *in;
+  queryHandler_t handler;
+  void *arg;
+} pipeline_t;
+
+// an output file and its pending bytes
+typedef struct writeBuffer {
+  FILE *f;
+  char *bytes;
+  size_t len;
+} writeBuffer_t;
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// reader stage: fill the ring with queries
+static void *reader(void *vp) {
+  pipeline_t *p = vp;
+  while (1) {
+    char *query = getString(p->in);
+    pthread_mutex_lock(&p->lock);
+    if (query == NULL) {
+      p->eof = 1;
+      pthread_cond_broadcast(&p->ready);
+      pthread_cond_signal(&p->done);
+      pthread_mutex_unlock(&p->lock);
+      return NULL;
+    }
+    while (p->nRead - p->nWritten >= RING_SIZE) {
+      pthread_cond_wait(&p->notFull, &p->lock);
+    }
+    job_t *job = &p->ring[p->nRead % RING_SIZE];
+    job->query = query;
+    job->done = 0;
+    p->nRead++;
+    pthread_cond_signal(&p->ready);
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+
+// search stage: handle queries one by one until all are taken
+static void *searcher(void *vp) {
+  pipeline_t *p = vp;
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    while (p->nTaken == p->nRead && !p->eof) {
+      pthread_cond_wait(&p->ready, &p->lock);
+    }
+    if (p->nTaken == p->nRead) {
+      pthread_mutex_unlock(&p->lock);
+      return NULL;
+    }
+    job_t *job = &p->ring[p->nTaken++ % RING_SIZE];
+    pthread_mutex_unlock(&p->lock);
+
+    FILE *out = open_memstream(&job->out, &job->outLen);
+    FILE *msg = open_memstream(&job->msg, &job->msgLen);
+    if (out == NULL || msg == NULL) {
+      error("execQueries: cannot buffer query output");
+    }
+    p->handler(job->query, out, msg, p->arg);
+    fclose(out);
+    fclose(msg);
+
+    pthread_mutex_lock(&p->lock);
+    job->done = 1;
+    pthread_cond_signal(&p->done);
+  }
+}
+
+// append len bytes to w, writing it out when full
+static void bufferWrite(writeBuffer_t *w, const char *bytes, size_t len) {
+  if (w->len + len > WRITE_BUFFER_SIZE) {
+    fwrite(w->bytes, 1, w->len, w->f);
+    w->len = 0;
+  }
+  if (len > WRITE_BUFFER_SIZE) {
+    fwrite(bytes, 1, len, w->f);
+  } else {
+    memcpy(w->bytes + w->len, bytes, len);
+    w->len += len;
+  }
+}
+
+// writer stage: output the jobs in input order, freeing their ring slots
+static void writer(pipeline_t *p, FILE *outFile, FILE *msgFile) {
+  writeBuffer_t out = {outFile, myMalloc(WRITE_BUFFER_SIZE), 0};
+  writeBuffer_t msg = {msgFile, myMalloc(WRITE_BUFFER_SIZE), 0};
+  pthread_mutex_lock(&p->lock);
+  while (1) {
+    while (p->nWritten == p->nRead ? !p->eof : !p->ring[p->nWritten % RING_SIZE].done) {
+      pthread_cond_wait(&p->done, &p->lock);
+    }
+    if (p->nWritten == p->nRead) {
+      break;
+    }
+    job_t *job = &p->ring[p->nWritten % RING_SIZE];
+    pthread_mutex_unlock(&p->lock);
+
+    bufferWrite(&out, job->out, job->outLen);
+    bufferWrite(&msg, job->msg, job->msgLen);
+    free(job->out);
+    free(job->msg);
+    free(job->query);
+
+    pthread_mutex_lock(&p->lock);
+    p->nWritten++;
+    pthread_cond_signal(&p->notFull);
+  }
+  pthread_mutex_unlock(&p->lock);
+  fwrite(out.bytes, 1, out.len, outFile);
+  fwrite(msg.bytes, 1, msg.len, msgFile);
+  free(out.bytes);
+  free(msg.bytes);
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// read queries, one per line, from in and pass each to handler; what each
+//    query writes to out and msg is copied to outFile and msgFile in input
+//    order, as if the queries were handled one after the other
+//    queries are handled in turn by the calling thread, unless "pipelined"
+//    is set or nThreads > 1: then they go through a reader thread, nThreads
+//    search threads and a writer
+void execQueries(FILE *in, queryHandler_t handler, void *arg, int nThreads,
+                 int pipelined, FILE *outFile, FILE *msgFile) {
+  assert(in && handler && nThreads > 0 && outFile && msgFile);
+  if (nThreads == 1 && !pipelined) {
+    char *query;
+    while ((query = getString(in)) != NULL) {
+      handler(query, outFile, msgFile, arg);
+      free(query);
+    }
+    return;
+  }
+
+  pipeline_t p;
+  p.ring = myMalloc(RING_SIZE * sizeof(*p.ring));
+  p.nRead = p.nTaken = p.nWritten = 0;
+  p.eof = 0;
+  pthread_mutex_init(&p.lock, NULL);
+  pthread_cond_init(&p.notFull, NULL);
+  pthread_cond_init(&p.ready, NULL);
+  pthread_cond_init(&p.done, NULL);
+  p.in = in;
+  p.handler = handler;
+  p.arg = arg;
+
+  // the calling thread is the writer
+  pthread_t *threads = myMalloc((nThreads + 1) * sizeof(*threads));
+  if (pthread_create(&threads[0], NULL, reader, &p) != 0) {
+    error("execQueries: cannot create thread");
+  }
+  for (int i = 1; i <= nThreads; i++) {
+    if (pthread_create(&threads[i], NULL, searcher, &p) != 0) {
+      error("execQueries: cannot create thread");
+    }
+  }
+  writer(&p, outFile, msgFile);
+  for (int i = 0; i <= nThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  free(threads);
+  pthread_cond_destroy(&p.done);
+  pthread_cond_destroy(&p.ready);
+  pthread_cond_destroy(&p.notFull);
+  pthread_mutex_destroy(&p.lock);
+  free(p.ring);
+}
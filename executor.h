@@ -0,0 +1,24 @@
+/*
+   executor.c, .h: module for running read-only queries as a pipeline:
+      a reader thread feeds a bounded ring of queries to search threads,
+      and a writer outputs their results in input order
+*/
+
+#ifndef _EXECUTOR_H_
+#define _EXECUTOR_H_
+
+#include <stdio.h>
+
+// handle one query, writing its results to out and its message to msg
+typedef void (*queryHandler_t)(char *query, FILE *out, FILE *msg, void *arg);
+
+// read queries, one per line, from in and pass each to handler; what each
+//    query writes to out and msg is copied to outFile and msgFile in input
+//    order, as if the queries were handled one after the other
+//    queries are handled in turn by the calling thread, unless "pipelined"
+//    is set or nThreads > 1: then they go through a reader thread, nThreads
+//    search threads and a writer
+void execQueries(FILE *in, queryHandler_t handler, void *arg, int nThreads,
+                 int pipelined, FILE *outFile, FILE *msgFile);
+
+#endif
@@ -0,0 +1,137 @@
+/*
+   format.c, .h: module for rendering text without the format string
+      parsing of printf(): text is collected in a buffer and written to its
+      file in one piece
+   Numbers are rendered exactly as printf("%d") and printf("%.<prec>f") do.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "utils.h"
+#include "format.h"
+
+// numbers whose scaled value is below 2^40 take the fast path of
+//    fmtFixed(): the scaled value is then exact to within 2^-13
+#define FIXED_FAST_MAX 1099511627776.0
+#define FIXED_MARGIN 1e-3
+
+static const double pow10s[FMT_MAX_PREC + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// make room for n more bytes
+static void reserve(fmtbuf_t *b, size_t n) {
+  if (b->len + n > FMT_BUF_SIZE) {
+    fmtFlush(b);
+  }
+}
+
+// append the digits of v, at least width of them (zero padded)
+static void appendDigits(fmtbuf_t *b, unsigned long long v, int width) {
+  char digits[32];
+  int n = 0;
+  do {
+    digits[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  while (n < width) {
+    digits[n++] = '0';
+  }
+  reserve(b, n);
+  while (n > 0) {
+    b->bytes[b->len++] = digits[--n];
+  }
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// start an empty buffer for file f
+void fmtInit(fmtbuf_t *b, FILE *f) {
+  assert(b && f);
+  b->f = f;
+  b->len = 0;
+}
+
+// append string s
+void fmtStr(fmtbuf_t *b, const char *s) {
+  size_t n = strlen(s);
+  if (n > FMT_BUF_SIZE) {
+    fmtFlush(b);
+    fwrite(s, 1, n, b->f);
+    return;
+  }
+  reserve(b, n);
+  memcpy(b->bytes + b->len, s, n);
+  b->len += n;
+}
+
+// append character c
+void fmtChar(fmtbuf_t *b, char c) {
+  reserve(b, 1);
+  b->bytes[b->len++] = c;
+}
+
+// append v as printf("%d") does
+void fmtInt(fmtbuf_t *b, int v) {
+  long long w = v;
+  if (w < 0) {
+    fmtChar(b, '-');
+    w = -w;
+  }
+  appendDigits(b, w, 1);
+}
+
+// append v as printf("%.<prec>f") does, prec <= FMT_MAX_PREC
+void fmtFixed(fmtbuf_t *b, double v, int prec) {
+  assert(prec >= 0 && prec <= FMT_MAX_PREC);
+  double scaled = fabs(v) * pow10s[prec];
+  if (scaled < FIXED_FAST_MAX) {
+    // the decimal expansion of a double never ends exactly halfway between
+    //    two values with prec digits, so rounding the scaled value is only
+    //    in doubt when it is too close to halfway for the error of the
+    //    multiplication: printf() decides those
+    double whole = floor(scaled);
+    double frac = scaled - whole;
+    if (fabs(frac - 0.5) > FIXED_MARGIN) {
+      unsigned long long q = (unsigned long long) whole + (frac > 0.5);
+      unsigned long long unit = (unsigned long long) pow10s[prec];
+      if (signbit(v)) {
+        fmtChar(b, '-');
+      }
+      appendDigits(b, q / unit, 1);
+      if (prec > 0) {
+        fmtChar(b, '.');
+        appendDigits(b, q % unit, prec);
+      }
+      return;
+    }
+  }
+  char text[512];
+  int n = snprintf(text, sizeof(text), "%.*f", prec, v);
+  assert(n > 0 && n < (int) sizeof(text));
+  fmtStr(b, text);
+}
+
+// write the buffered text to the file
+void fmtFlush(fmtbuf_t *b) {
+  if (b->len) {
+    fwrite(b->bytes, 1, b->len, b->f);
+    b->len = 0;
+  }
+}
+
+// give f, which is just opened, a stdio buffer of FMT_FILE_BUFFER_SIZE bytes
+//    so that it is written in large blocks, return the buffer, to be freed
+//    once f is closed
+char *fmtFileBuffer(FILE *f) {
+  char *buf = myMalloc(FMT_FILE_BUFFER_SIZE);
+  if (setvbuf(f, buf, _IOFBF, FMT_FILE_BUFFER_SIZE) != 0) {
+    warning("fmtFileBuffer: cannot set the buffer of a file");
+  }
+  return buf;
+}
@@ -0,0 +1,47 @@
+/*
+   format.c, .h: module for rendering text without the format string
+      parsing of printf(): text is collected in a buffer and written to its
+      file in one piece
+   Numbers are rendered exactly as printf("%d") and printf("%.<prec>f") do.
+*/
+
+#ifndef _FORMAT_H_
+#define _FORMAT_H_
+
+#include <stdio.h>
+
+#define FMT_BUF_SIZE 4096
+#define FMT_MAX_PREC 9      // largest precision of fmtFixed()
+#define FMT_FILE_BUFFER_SIZE (1 << 20)
+
+// text waiting to be written to f
+typedef struct fmtbuf {
+  FILE *f;
+  size_t len;
+  char bytes[FMT_BUF_SIZE];
+} fmtbuf_t;
+
+// start an empty buffer for file f
+void fmtInit(fmtbuf_t *b, FILE *f);
+
+// append string s
+void fmtStr(fmtbuf_t *b, const char *s);
+
+// append character c
+void fmtChar(fmtbuf_t *b, char c);
+
+// append v as printf("%d") does
+void fmtInt(fmtbuf_t *b, int v);
+
+// append v as printf("%.<prec>f") does, prec <= FMT_MAX_PREC
+void fmtFixed(fmtbuf_t *b, double v, int prec);
+
+// write the buffered text to the file
+void fmtFlush(fmtbuf_t *b);
+
+// give f, which is just opened, a stdio buffer of FMT_FILE_BUFFER_SIZE bytes
+//    so that it is written in large blocks, return the buffer, to be freed
+//    once f is closed
+char *fmtFileBuffer(FILE *f);
+
+#endif
@@ -0,0 +1,190 @@
+/*
+   gendata.c: generator of synthetic, suburb-shaped datasets and query files
+      for benchmarking (see "make bench")
+   Usage: gendata rows queries seed data.csv queries.in
+   Names are made of syllables and repeat as in the real dataset: about 93%
+      of names are unique, 5% appear twice and the rest up to a dozen times.
+   Queries mix exact hits (60%), names not in the dataset (20%) and hits
+      with one typo (20%).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utils.h"
+
+#define N_SYLLABLES 64
+#define HIT_PERCENT 60
+#define MISS_PERCENT 20     // the rest are misspelt hits
+
+static const char *syllables[N_SYLLABLES] = {
+  "ba", "ber", "bo", "bri", "ca", "cal", "car", "co",
+  "da", "dar", "del", "don", "ga", "gal", "gle", "gun",
+  "ha", "hil", "ka", "kal", "ker", "ki", "la", "lan",
+  "lee", "lin", "ma", "mar", "mel", "mon", "mor", "na",
+  "nar", "nel", "no", "ol", "pa", "pen", "ra", "ral",
+  "ren", "ri", "ro", "sa", "sel", "ston", "ta", "tal",
+  "ter", "ton", "tul", "um", "va", "vil", "wa", "wal",
+  "wan", "wee", "wil", "win", "ya", "yan", "yer", "ville"
+};
+
+static const char *suffixes[] = {" North", " South", " East", " West", " Heights"};
+
+// states, with their share of the records in the real dataset
+static const struct {
+  int code;
+  const char *name;
+  int weight;
+} states[] = {
+  {1, "New South Wales", 4525}, {2, "Victoria", 2940}, {3, "Queensland", 3229},
+  {4, "South Australia", 1692}, {5, "Western Australia", 1697}, {6, "Tasmania", 776},
+  {7, "Northern Territory", 302}, {8, "Australian Capital Territory", 136},
+  {9, "Other Territories", 5}
+};
+#define N_STATES ((int) (sizeof(states) / sizeof(states[0])))
+#define LGAS_PER_STATE 100
+
+static uint64_t rngState;
+
+// next number of a xorshift64* generator, the same on every platform
+static uint64_t rng(void) {
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return rngState * 2685821657736338717ULL;
+}
+
+// random integer in [0, n)
+static uint64_t rngBelow(uint64_t n) {
+  return rng() % n;
+}
+
+// write into buf the name of number i, different for every i
+static void makeName(uint64_t i, char *buf) {
+  char *p = buf;
+  // at least two syllables, most significant first
+  uint64_t digits[16];
+  int n = 0;
+  for (uint64_t v = i + N_SYLLABLES; v > 0; v /= N_SYLLABLES) {
+    digits[n++] = v % N_SYLLABLES;
+  }
+  while (n > 0) {
+    p += sprintf(p, "%s", syllables[digits[--n]]);
+  }
+  buf[0] = toupper((unsigned char) buf[0]);
+  // some names get a suffix, the syllables alone keep them distinct
+  if ((i * 2654435761u) % 10 == 0) {
+    strcpy(p, suffixes[(i / 10) % (sizeof(suffixes) / sizeof(suffixes[0]))]);
+  }
+}
+
+// number of records of a name: 1 with 93%, then each more with 25%
+static int multiplicity(void) {
+  int m = 1;
+  if (rngBelow(100) < 7) {
+    m++;
+    while (m < 12 && rngBelow(100) < 25) {
+      m++;
+    }
+  }
+  return m;
+}
+
+// a state index, drawn by the states' weights
+static int pickState(void) {
+  int total = 0;
+  for (int s = 0; s < N_STATES; s++) {
+    total += states[s].weight;
+  }
+  int w = rngBelow(total);
+  for (int s = 0; s < N_STATES; s++) {
+    if (w < states[s].weight) {
+      return s;
+    }
+    w -= states[s].weight;
+  }
+  return 0;
+}
+
+// replace name by a copy with one typo
+static void misspell(char *name) {
+  size_t len = strlen(name);
+  size_t at = rngBelow(len);
+  char c = 'a' + rngBelow(26);
+  switch (rngBelow(3)) {
+    case 0:     // substitution
+      name[at] = (name[at] == c) ? 'z' : c;
+      break;
+    case 1:     // deletion
+      if (len > 1) {
+        memmove(name + at, name + at + 1, len - at);
+        break;
+      }
+      // fall through
+    default:    // insertion
+      memmove(name + at + 1, name + at, len - at + 1);
+      name[at] = c;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 6) {
+    fprintf(stderr, "Usage: %s rows queries seed data.csv queries.in\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  long rows = strtol(argv[1], NULL, 10);
+  long nQueries = strtol(argv[2], NULL, 10);
+  rngState = strtoull(argv[3], NULL, 10) * 0x9E3779B97F4A7C15ULL + 1;
+  if (rows < 1 || nQueries < 0) {
+    error("gendata: rows must be positive, queries not negative");
+  }
+
+  // the name number of every row, repeated names shuffled over the file
+  uint64_t *names = myMalloc(rows * sizeof(*names));
+  uint64_t nNames = 0;
+  for (long r = 0; r < rows; nNames++) {
+    for (int m = multiplicity(); m > 0 && r < rows; m--) {
+      names[r++] = nNames;
+    }
+  }
+  for (long r = rows - 1; r > 0; r--) {
+    long other = rngBelow(r + 1);
+    uint64_t tmp = names[r];
+    names[r] = names[other];
+    names[other] = tmp;
+  }
+
+  FILE *f = myFopen(argv[4], "w");
+  fprintf(f, "COMP20003 Code,Official Code Suburb,Official Name Suburb,Year,"
+             "Official Code State,Official Name State,"
+             "Official Code Local Government Area,Official Name Local Government Area,"
+             "Latitude,Longitude\n");
+  char name[MAX_STR_LEN + 1], lga[MAX_STR_LEN + 1];
+  for (long r = 0; r < rows; r++) {
+    int s = pickState();
+    int l = rngBelow(LGAS_PER_STATE);
+    makeName(names[r], name);
+    makeName(1000 * states[s].code + l, lga);
+    fprintf(f, "%ld,%ld,%s,2021,%d,%s,%d,%s,%.7f,%.7f\n", r + 1, 10000 + (long) names[r],
+            name, states[s].code, states[s].name, 10000 * states[s].code + l, lga,
+            -10.0 - rngBelow(33000000) / 1e6, 113.0 + rngBelow(41000000) / 1e6);
+  }
+  fclose(f);
+
+  f = myFopen(argv[5], "w");
+  for (long q = 0; q < nQueries; q++) {
+    int kind = rngBelow(100);
+    if (kind < HIT_PERCENT) {
+      makeName(names[rngBelow(rows)], name);
+    } else if (kind < HIT_PERCENT + MISS_PERCENT) {
+      makeName(nNames + rngBelow(nNames + 1), name);    // never generated
+    } else {
+      makeName(names[rngBelow(rows)], name);
+      misspell(name);
+    }
+    fprintf(f, "%s\n", name);
+  }
+  fclose(f);
+  free(names);
+  return 0;
+}
@@ -0,0 +1,326 @@
+/*
+   hashTable.c, .h: module for working with a hash table
+      open addressing on suburb names, all records sharing a name are
+      chained in one slot in appearance order; the table grows
+      incrementally, a few slots being moved on every insertion
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include "utils.h"
+#include "hashTable.h"
+
+#define INITIAL_SIZE 16     // number of slots of a new table, a power of 2
+#define MAX_LOAD 0.5        // grow when used (or deleted) slots exceed this
+#define MIGRATE_STEP 8      // old slots moved to the new table per insertion
+
+typedef struct hnode hnode_t;
+struct hnode {
+    void *data;
+    hnode_t *sameKey;       // next record with the same key, in appearance order
+    hnode_t *prev, *next;   // neighbours in insertion order
+};
+
+typedef enum {
+    EMPTY = 0,
+    USED,
+    DELETED                 // tombstone: keeps probe sequences going
+} slotState_t;
+
+typedef struct slot {
+    unsigned int hash;      // cached hash of the key
+    slotState_t state;
+    hnode_t *head, *tail;   // chain of records sharing the key
+} slot_t;
+
+typedef struct table {
+    slot_t *slots;
+    size_t size;            // number of slots, a power of 2
+    size_t used;            // number of non-EMPTY slots
+    size_t live;            // number of USED slots
+} table_t;
+
+struct htable {
+    table_t cur;            // table receiving new keys
+    table_t old;            // table being moved into cur, or size 0
+    size_t migrated;        // slots of old already moved
+    hnode_t *first, *last;  // all records in insertion order
+    size_t length;          // number of records
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+static void tableCreate(table_t *t, size_t size) {
+    t->slots = myCalloc(size, sizeof(*t->slots));
+    t->size = size;
+    t->used = 0;
+    t->live = 0;
+}
+
+// look up key in t, counting comparisons if compare_info is not NULL
+//     return the index of its slot, or -1 if not found
+//     *insertAt is set to where the key would be inserted
+static long tableFind(table_t *t, char *key, unsigned int hash, long *insertAt,
+                      comparison_info_t *compare_info) {
+    *insertAt = -1;
+    if (t->size == 0) {
+        return -1;
+    }
+    size_t mask = t->size - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        slot_t *s = &t->slots[i];
+        if (compare_info) {
+            compare_info->node_accesses++;   // each probed slot is a node access
+        }
+        if (s->state == EMPTY) {
+            if (*insertAt < 0) {
+                *insertAt = i;
+            }
+            return -1;
+        }
+        if (s->state == DELETED) {
+            if (*insertAt < 0) {
+                *insertAt = i;
+            }
+            continue;
+        }
+        if (s->hash != hash) {
+            continue;
+        }
+        int cmp;
+        if (compare_info) {
+            compare_info->string_comparisons++;
+            cmp = dataKeyCmp(s->head->data, key, &(compare_info->bit_comparisons));
+        } else {
+            cmp = dataKeyCmp(s->head->data, key, NULL);
+        }
+        if (cmp == 0) {
+            return i;
+        }
+    }
+}
+
+// move a USED slot (from the old table) into a free slot of t
+static void tablePlace(table_t *t, slot_t *from) {
+    size_t mask = t->size - 1;
+    size_t i = from->hash & mask;
+    while (t->slots[i].state == USED) {
+        i = (i + 1) & mask;
+    }
+    if (t->slots[i].state == EMPTY) {
+        t->used++;
+    }
+    t->slots[i] = *from;
+    t->live++;
+    from->state = DELETED;
+}
+
+// move up to "steps" slots of the old table into the current one
+static void htMigrate(htable_t *ht, size_t steps) {
+    while (ht->old.size && steps-- > 0) {
+        slot_t *s = &ht->old.slots[ht->migrated++];
+        if (s->state == USED) {
+            tablePlace(&ht->cur, s);
+        }
+        if (ht->migrated == ht->old.size) {
+            free(ht->old.slots);
+            ht->old.slots = NULL;
+            ht->old.size = 0;
+        }
+    }
+}
+
+// start moving everything into a new table, doubled unless it was
+//     mostly filled with tombstones
+static void htGrow(htable_t *ht) {
+    htMigrate(ht, ht->old.size);         // finish any previous move
+    ht->old = ht->cur;
+    ht->migrated = 0;
+    size_t size = ht->old.size;
+    if (ht->old.live * 4 > size) {
+        size *= 2;
+    }
+    tableCreate(&ht->cur, size);
+}
+
+// unlink node from the insertion-order list
+static void htUnlink(htable_t *ht, hnode_t *node) {
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        ht->first = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    } else {
+        ht->last = node->prev;
+    }
+    ht->length--;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create & return an empty hash table
+void *htCreate() {
+    htable_t *ht = myMalloc(sizeof(*ht));
+    tableCreate(&ht->cur, INITIAL_SIZE);
+    ht->old.slots = NULL;
+    ht->old.size = 0;
+    ht->migrated = 0;
+    ht->first = NULL;
+    ht->last = NULL;
+    ht->length = 0;
+    return ht;
+}
+
+// free hash table ht, also applying dataFree() if not NULL
+void htFree(void *vht, void (*dataFree)(void *)) {
+    htable_t *ht = vht;
+    assert(ht != NULL);
+    hnode_t *curr = ht->first;
+    while (curr) {
+        hnode_t *tmp = curr;
+        curr = curr->next;
+        if (dataFree) {
+            dataFree(tmp->data);
+        }
+        free(tmp);
+    }
+    free(ht->cur.slots);
+    free(ht->old.slots);
+    free(ht);
+}
+
+// insert a single data to the hash table ht
+//     return number of records inserted (1 or 0)
+int htInsert(void *vht, void *vdata) {
+    htable_t *ht = vht;
+    data_t *data = vdata;
+    assert(ht && data);
+    htMigrate(ht, MIGRATE_STEP);
+
+    char *key = data->suburbName;
+    unsigned int hash = hashString(key);
+    long at, i = tableFind(&ht->cur, key, hash, &at, NULL);
+    if (i < 0 && ht->old.size) {
+        long oldAt, j = tableFind(&ht->old, key, hash, &oldAt, NULL);
+        if (j >= 0) {                       // key not moved yet: move it now
+            tablePlace(&ht->cur, &ht->old.slots[j]);
+            i = tableFind(&ht->cur, key, hash, &at, NULL);
+        }
+    }
+    if (i < 0 && ht->cur.used + 1 > ht->cur.size * MAX_LOAD) {
+        htGrow(ht);
+        i = tableFind(&ht->cur, key, hash, &at, NULL);
+    }
+
+    hnode_t *new = myMalloc(sizeof(*new));
+    new->data = data;
+    new->sameKey = NULL;
+    new->next = NULL;
+    new->prev = ht->last;
+    if (ht->last) {
+        ht->last->next = new;
+    } else {
+        ht->first = new;
+    }
+    ht->last = new;
+    ht->length++;
+
+    if (i >= 0) {                           // append to the key's chain
+        slot_t *s = &ht->cur.slots[i];
+        s->tail->sameKey = new;
+        s->tail = new;
+    } else {                                // key seen for the first time
+        slot_t *s = &ht->cur.slots[at];
+        if (s->state == EMPTY) {
+            ht->cur.used++;
+        }
+        s->state = USED;
+        s->hash = hash;
+        s->head = new;
+        s->tail = new;
+        ht->cur.live++;
+    }
+    return 1;
+}
+
+// remove all record sharing "key",
+//     return number of records removed
+int htDelete(void *vht, void *vkey) {
+    htable_t *ht = vht;
+    char *key = vkey;
+    assert(ht && key);
+    unsigned int hash = hashString(key);
+    table_t *t = &ht->cur;
+    long at, i = tableFind(t, key, hash, &at, NULL);
+    if (i < 0 && ht->old.size) {
+        t = &ht->old;
+        i = tableFind(t, key, hash, &at, NULL);
+    }
+    if (i < 0) {
+        return 0;
+    }
+
+    int removals = 0;
+    slot_t *s = &t->slots[i];
+    hnode_t *curr = s->head;
+    while (curr) {
+        hnode_t *tmp = curr;
+        curr = curr->sameKey;
+        htUnlink(ht, tmp);
+        dataFree(tmp->data);
+        free(tmp);
+        removals++;
+    }
+    s->state = DELETED;
+    s->head = s->tail = NULL;
+    t->live--;
+    return removals;
+}
+
+// print all records to f in insertion order, using "labels" for data field label
+void htPrint(void *vht, char **labels, FILE *f) {
+    htable_t *ht = vht;
+    assert(ht);
+    for (hnode_t *curr = ht->first; curr; curr = curr->next) {
+        dataPrint(curr->data, labels, f);
+    }
+}
+
+// find all records in "source" having "key" and add them to "target",
+//      in appearance order
+//      return number of found data
+int htSearch(void *key, void *vsource, void *vtarget, comparison_info_t *compare_info) {
+    htable_t *source = vsource;
+    assert(source && vtarget && key);
+    unsigned int hash = hashString(key);
+    table_t *t = &source->cur;
+    long at, i = tableFind(t, key, hash, &at, compare_info);
+    if (i < 0 && source->old.size) {
+        t = &source->old;
+        i = tableFind(t, key, hash, &at, compare_info);
+    }
+    if (i < 0) {
+        return 0;
+    }
+
+    int matches = 0;
+    for (hnode_t *curr = t->slots[i].head; curr; curr = curr->sameKey) {
+        htInsert(vtarget, curr->data);
+        matches++;
+    }
+    return matches;
+}
+
+// output all records in csv format, in insertion order
+void htCsvOutput(void *vht, FILE *f) {
+    htable_t *ht = vht;
+    assert(ht);
+    for (hnode_t *p = ht->first; p; p = p->next) {
+        dataCsvOutput(p->data, f);
+    }
+}
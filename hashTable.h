@@ -0,0 +1,41 @@
+/*
+   hashTable.c, .h: module for working with a hash table
+      open addressing on suburb names, all records sharing a name are
+      chained in one slot in appearance order; the table grows
+      incrementally, a few slots being moved on every insertion
+*/
+
+#ifndef _HASH_TABLE_H_
+#define _HASH_TABLE_H_
+
+#include "data.h"
+#include "comparison_info.h"
+
+typedef struct htable htable_t;
+
+// create & return an empty hash table
+void *htCreate();
+
+// insert a single data to the hash table ht
+//     return number of records inserted (1 or 0)
+int htInsert(void *ht, void *data);
+
+// remove all record sharing "key",
+//     return number of records removed
+int htDelete(void *ht, void *key);
+
+// print all records to f in insertion order, using "labels" for data field label
+void htPrint(void *ht, char **labels, FILE *f);
+
+// find all records in "source" having "key" and add them to "target",
+//      in appearance order
+//      return number of found data
+int htSearch(void *key, void *source, void *target, comparison_info_t *compare_info);
+
+// free hash table ht, also applying dataFree() if not NULL
+void htFree(void *ht, void (*dataFree)(void *data));
+
+// output all records in csv format, in insertion order
+void htCsvOutput(void *ht, FILE *f);
+
+#endif
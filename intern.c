@@ -0,0 +1,167 @@
+/*
+   intern.c, .h: module for interning strings: each distinct value is stored
+      once, so that equal values are the same pointer
+   A shared table owns its strings and may be used by several threads; a
+      cache is a private, lock-free front of a shared table for one thread.
+   Two strings interned in the same table, directly or through its caches,
+      are equal exactly when their pointers are equal: an equality filter
+      on an interned column compares pointers with what internLookup()
+      returns for the value filtered on (NULL matches no record).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "arena.h"
+#include "intern.h"
+
+#define INITIAL_SIZE 64     // number of slots of a new table, a power of 2
+#define STRING_BLOCK_SIZE (64 * 1024)
+
+typedef struct slot {
+  unsigned int hash;
+  char *s;                  // interned string, NULL if the slot is empty
+} slot_t;
+
+struct intern {
+  slot_t *slots;
+  size_t size;              // a power of 2
+  size_t n;
+  intern_t *shared;         // table behind a cache, NULL for a shared table
+  arena_t *strings;         // strings of a shared table
+  pthread_mutex_t lock;     // guards a shared table
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+static intern_t *tableCreate(void) {
+  intern_t *t = myMalloc(sizeof(*t));
+  t->slots = myCalloc(INITIAL_SIZE, sizeof(*t->slots));
+  t->size = INITIAL_SIZE;
+  t->n = 0;
+  return t;
+}
+
+// return the slot of s, or the empty slot where it goes
+static slot_t *findSlot(intern_t *t, const char *s, unsigned int hash) {
+  size_t mask = t->size - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    slot_t *slot = &t->slots[i];
+    if (slot->s == NULL || (slot->hash == hash && strcmp(slot->s, s) == 0)) {
+      return slot;
+    }
+  }
+}
+
+// fill an empty slot with interned string s, growing the table if needed
+static void addSlot(intern_t *t, slot_t *slot, char *s, unsigned int hash) {
+  slot->hash = hash;
+  slot->s = s;
+  t->n++;
+  if (2 * t->n > t->size) {
+    slot_t *old = t->slots;
+    size_t oldSize = t->size;
+    t->size *= 2;
+    t->slots = myCalloc(t->size, sizeof(*t->slots));
+    for (size_t i = 0; i < oldSize; i++) {
+      if (old[i].s) {
+        *findSlot(t, old[i].s, old[i].hash) = old[i];
+      }
+    }
+    free(old);
+  }
+}
+
+// internString() on a shared table, with its lock held
+static char *sharedString(intern_t *t, const char *s, unsigned int hash) {
+  slot_t *slot = findSlot(t, s, hash);
+  if (slot->s == NULL) {
+    char *interned = arenaStrdup(t->strings, s, strlen(s));
+    addSlot(t, slot, interned, hash);   // slot is stale if the table grew
+    return interned;
+  }
+  return slot->s;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create an empty shared table
+intern_t *internCreate(void) {
+  intern_t *t = tableCreate();
+  t->shared = NULL;
+  t->strings = arenaCreate(STRING_BLOCK_SIZE);
+  pthread_mutex_init(&t->lock, NULL);
+  return t;
+}
+
+// create an empty cache of shared table "shared", for use by one thread
+intern_t *internCreateCache(intern_t *shared) {
+  assert(shared && shared->shared == NULL);
+  intern_t *t = tableCreate();
+  t->shared = shared;
+  t->strings = NULL;
+  return t;
+}
+
+// return the interned copy of s, adding it if needed
+char *internString(intern_t *t, const char *s) {
+  assert(t && s);
+  unsigned int hash = hashString(s);
+  if (t->shared == NULL) {
+    pthread_mutex_lock(&t->lock);
+    char *interned = sharedString(t, s, hash);
+    pthread_mutex_unlock(&t->lock);
+    return interned;
+  }
+
+  // a cache holds the shared table's copies
+  slot_t *slot = findSlot(t, s, hash);
+  if (slot->s == NULL) {
+    intern_t *shared = t->shared;
+    pthread_mutex_lock(&shared->lock);
+    char *interned = sharedString(shared, s, hash);
+    pthread_mutex_unlock(&shared->lock);
+    addSlot(t, slot, interned, hash);
+    return interned;
+  }
+  return slot->s;
+}
+
+// return the interned copy of s, or NULL if s was never interned
+char *internLookup(intern_t *t, const char *s) {
+  assert(t && s);
+  if (t->shared) {
+    t = t->shared;
+  }
+  pthread_mutex_lock(&t->lock);
+  char *interned = findSlot(t, s, hashString(s))->s;
+  pthread_mutex_unlock(&t->lock);
+  return interned;
+}
+
+// number of distinct strings in t
+size_t internCount(intern_t *t) {
+  if (t->shared) {
+    return t->n;
+  }
+  pthread_mutex_lock(&t->lock);
+  size_t n = t->n;
+  pthread_mutex_unlock(&t->lock);
+  return n;
+}
+
+// free a table and, if shared, all its strings
+void internFree(intern_t *t) {
+  if (t == NULL) {
+    return;
+  }
+  if (t->shared == NULL) {
+    arenaFree(t->strings);
+    pthread_mutex_destroy(&t->lock);
+  }
+  free(t->slots);
+  free(t);
+}
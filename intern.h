@@ -0,0 +1,37 @@
+/*
+   intern.c, .h: module for interning strings: each distinct value is stored
+      once, so that equal values are the same pointer
+   A shared table owns its strings and may be used by several threads; a
+      cache is a private, lock-free front of a shared table for one thread.
+   Two strings interned in the same table, directly or through its caches,
+      are equal exactly when their pointers are equal: an equality filter
+      on an interned column compares pointers with what internLookup()
+      returns for the value filtered on (NULL matches no record).
+*/
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include <stddef.h>
+
+typedef struct intern intern_t;
+
+// create an empty shared table
+intern_t *internCreate(void);
+
+// create an empty cache of shared table "shared", for use by one thread
+intern_t *internCreateCache(intern_t *shared);
+
+// return the interned copy of s, adding it if needed
+char *internString(intern_t *t, const char *s);
+
+// return the interned copy of s, or NULL if s was never interned
+char *internLookup(intern_t *t, const char *s);
+
+// number of distinct strings in t
+size_t internCount(intern_t *t);
+
+// free a table and, if shared, all its strings
+void internFree(intern_t *t);
+
+#endif
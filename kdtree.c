@@ -0,0 +1,358 @@
+/*
+   kdtree.c, .h: module for a spatial index of records by latitude and
+      longitude, a k-d tree answering k-nearest-neighbour and within-radius
+      queries in great-circle (haversine) distance
+   Points are placed on the unit sphere, in x, y, z, where the straight-line
+      distance between two points grows with their great-circle distance:
+      the tree splits on those 3 axes and its bounds hold everywhere,
+      across the date line and near the poles alike.
+   The tree is implicit: nodes[] holds the points in the order of a balanced
+      tree, each subtree's root at the middle of its range, so no links are
+      stored and a node is 32 bytes.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include "utils.h"
+#include "kdtree.h"
+
+#define N_AXES 3
+#define RADIANS (M_PI / 180.0)
+#define RANGE_SLACK 1e-12     // relative, so rounding never prunes a point in range
+
+typedef struct kdNode {
+  double pos[N_AXES];         // on the unit sphere
+  uint32_t order;             // index of the record in records[]
+  uint32_t axis;              // split axis of the subtree rooted here
+} kdNode_t;
+
+// a record's position in degrees, as read from it
+typedef struct kdPoint {
+  double latitude, longitude;
+} kdPoint_t;
+
+struct kdtree {
+  kdNode_t *nodes;
+  data_t **records;           // in the order given to kdtreeCreate()
+  kdPoint_t *points;          // of records[], in the same order
+  size_t n;
+};
+
+// a point kept by a search, dist is its squared straight-line distance
+typedef struct kdFound {
+  double dist;
+  uint32_t order;
+} kdFound_t;
+
+// state of a nearest search: the k best points so far within limit, worst
+//    first in a max-heap
+typedef struct kdSearch {
+  double pos[N_AXES];
+  double limit;               // squared straight-line distance, INFINITY for none
+  kdFound_t *heap;
+  size_t nHeap, k;
+  comparison_info_t *compare_info;
+} kdSearch_t;
+
+// state of a radius search: the points found so far
+typedef struct kdRange {
+  double pos[N_AXES];
+  double limit;               // squared straight-line distance of the radius
+  kdFound_t *found;
+  size_t nFound, size;
+  comparison_info_t *compare_info;
+} kdRange_t;
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// place a point given in degrees on the unit sphere
+static void toSphere(double latitude, double longitude, double *pos) {
+  double lat = latitude * RADIANS, lon = longitude * RADIANS;
+  pos[0] = cos(lat) * cos(lon);
+  pos[1] = cos(lat) * sin(lon);
+  pos[2] = sin(lat);
+}
+
+// squared straight-line distance between two points of the unit sphere
+static double chord2(const double *a, const double *b) {
+  double dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+// = 1 if a point found ranks after another, the nearest ranking first
+static int foundAfter(const kdFound_t *a, const kdFound_t *b) {
+  return a->dist > b->dist || (a->dist == b->dist && a->order > b->order);
+}
+
+static int cmpFound(const void *a, const void *b) {
+  return foundAfter(a, b) - foundAfter(b, a);
+}
+
+// restore the max-heap from heap[i] down
+static void siftDown(kdFound_t *heap, size_t n, size_t i) {
+  for (;;) {
+    size_t worst = i, l = 2 * i + 1, r = l + 1;
+    if (l < n && foundAfter(&heap[l], &heap[worst])) {
+      worst = l;
+    }
+    if (r < n && foundAfter(&heap[r], &heap[worst])) {
+      worst = r;
+    }
+    if (worst == i) {
+      return;
+    }
+    kdFound_t tmp = heap[i];
+    heap[i] = heap[worst];
+    heap[worst] = tmp;
+    i = worst;
+  }
+}
+
+// keep the point of record order if it is within s->limit and among the
+//    s->k nearest so far
+static void keepNearest(kdSearch_t *s, uint32_t order, double dist) {
+  kdFound_t f = {dist, order};
+  if (dist > s->limit) {
+    return;
+  }
+  if (s->nHeap < s->k) {
+    // sift up
+    size_t i = s->nHeap++;
+    while (i > 0 && foundAfter(&f, &s->heap[(i - 1) / 2])) {
+      s->heap[i] = s->heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    s->heap[i] = f;
+  } else if (foundAfter(&s->heap[0], &f)) {
+    s->heap[0] = f;
+    siftDown(s->heap, s->nHeap, 0);
+  }
+}
+
+// add the point of record order to the points found by s
+static void addInRange(kdRange_t *s, uint32_t order, double dist) {
+  if (s->nFound == s->size) {
+    s->size = s->size ? 2 * s->size : 16;
+    s->found = myRealloc(s->found, s->size * sizeof(*s->found));
+  }
+  s->found[s->nFound].dist = dist;
+  s->found[s->nFound++].order = order;
+}
+
+// put the node of rank nth in nodes[lo..hi-1] by axis at index nth, those
+//    before it at or below it, those after it at or above it (quickselect)
+static void selectNth(kdNode_t *nodes, long lo, long hi, long nth, int axis) {
+  while (hi - lo > 1) {
+    double pivot = nodes[lo + (hi - lo) / 2].pos[axis];
+    long i = lo, j = hi - 1;
+    while (i <= j) {
+      while (nodes[i].pos[axis] < pivot) {
+        i++;
+      }
+      while (nodes[j].pos[axis] > pivot) {
+        j--;
+      }
+      if (i <= j) {
+        kdNode_t tmp = nodes[i];
+        nodes[i++] = nodes[j];
+        nodes[j--] = tmp;
+      }
+    }
+    // now nodes[lo..j] <= pivot, nodes[i..hi-1] >= pivot, those between = pivot
+    if (nth <= j) {
+      hi = j + 1;
+    } else if (nth >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+// arrange nodes[lo..hi-1] into a subtree, split on the axis of widest spread
+static void build(kdNode_t *nodes, size_t lo, size_t hi) {
+  if (hi - lo < 2) {
+    if (hi > lo) {
+      nodes[lo].axis = 0;
+    }
+    return;
+  }
+  double low[N_AXES], high[N_AXES];
+  for (int a = 0; a < N_AXES; a++) {
+    low[a] = high[a] = nodes[lo].pos[a];
+  }
+  for (size_t i = lo + 1; i < hi; i++) {
+    for (int a = 0; a < N_AXES; a++) {
+      if (nodes[i].pos[a] < low[a]) {
+        low[a] = nodes[i].pos[a];
+      } else if (nodes[i].pos[a] > high[a]) {
+        high[a] = nodes[i].pos[a];
+      }
+    }
+  }
+  int axis = 0;
+  for (int a = 1; a < N_AXES; a++) {
+    if (high[a] - low[a] > high[axis] - low[axis]) {
+      axis = a;
+    }
+  }
+  size_t mid = lo + (hi - lo) / 2;
+  selectNth(nodes, lo, hi, mid, axis);
+  nodes[mid].axis = axis;
+  build(nodes, lo, mid);
+  build(nodes, mid + 1, hi);
+}
+
+// the search kernels, counting visits (name_counted) or not (name_fast)
+#define COUNTING 1
+#include "kdtree_search.inc"
+#undef COUNTING
+#define COUNTING 0
+#include "kdtree_search.inc"
+#undef COUNTING
+
+
+/*----- implementation of all funtions -----*/
+
+// build the index of records[0..n-1], only the positions of lazy records
+//    are decoded; the array is copied, the records are left to their owner
+kdtree_t *kdtreeCreate(data_t **records, size_t n) {
+  if (n > UINT32_MAX) {
+    error("kdtreeCreate: too many records");
+  }
+  kdtree_t *kd = myMalloc(sizeof(*kd));
+  kd->n = n;
+  kd->records = myMalloc((n ? n : 1) * sizeof(*kd->records));
+  kd->points = myMalloc((n ? n : 1) * sizeof(*kd->points));
+  kd->nodes = myMalloc((n ? n : 1) * sizeof(*kd->nodes));
+  for (size_t i = 0; i < n; i++) {
+    kdPoint_t *p = &kd->points[i];
+    dataGetPosition(records[i], &p->latitude, &p->longitude);
+    kd->records[i] = records[i];
+    toSphere(p->latitude, p->longitude, kd->nodes[i].pos);
+    kd->nodes[i].order = i;
+  }
+  build(kd->nodes, 0, n);
+  return kd;
+}
+
+// find the k records nearest to the point (in degrees), nearest first,
+//    equal distances in the order of the records given to kdtreeCreate()
+//    matches[] must hold k entries, return: number of matches, less than
+//    k if the index is smaller
+size_t kdtreeNearest(const kdtree_t *kd, double latitude, double longitude, size_t k,
+                     kdMatch_t *matches, comparison_info_t *compare_info) {
+  kdSearch_t s;
+  toSphere(latitude, longitude, s.pos);
+  s.limit = INFINITY;
+  s.heap = myMalloc((k ? k : 1) * sizeof(*s.heap));
+  s.nHeap = 0;
+  s.k = k;
+  s.compare_info = compare_info;
+  if (k > 0 && compare_info) {
+    nearest_points_counted(kd, 0, kd->n, &s);
+  } else if (k > 0) {
+    nearest_points_fast(kd, 0, kd->n, &s);
+  }
+
+  // empty the heap, worst first, into the end of matches[]
+  size_t found = s.nHeap;
+  while (s.nHeap > 0) {
+    kdFound_t worst = s.heap[0];
+    s.heap[0] = s.heap[--s.nHeap];
+    siftDown(s.heap, s.nHeap, 0);
+    const kdPoint_t *p = &kd->points[worst.order];
+    matches[s.nHeap].data = kd->records[worst.order];
+    matches[s.nHeap].km = kdHaversine(latitude, longitude, p->latitude, p->longitude);
+  }
+  free(s.heap);
+  return found;
+}
+
+// find the records within km of the point (in degrees), ordered as by
+//    kdtreeNearest(), into *matches, a new array that the caller frees;
+//    with max > 0, only the max nearest of them are searched for
+//    return: number of matches
+size_t kdtreeWithin(const kdtree_t *kd, double latitude, double longitude, double km,
+                    size_t max, kdMatch_t **matches, comparison_info_t *compare_info) {
+  double pos[N_AXES];
+  toSphere(latitude, longitude, pos);
+  double half = fmin(km / EARTH_RADIUS_KM, M_PI) / 2;
+  double limit = 4 * sin(half) * sin(half) * (1 + RANGE_SLACK);
+  kdFound_t *found = NULL;
+  size_t nFound = 0;
+  if (max > kd->n) {
+    max = kd->n;                // the heap never holds more
+  }
+  if (max > 0) {
+    // a nearest search bounded by the radius, which prunes by the max-th
+    //    point found once it has max of them
+    kdSearch_t s;
+    memcpy(s.pos, pos, sizeof(pos));
+    s.limit = limit;
+    s.heap = found = myMalloc(max * sizeof(*s.heap));
+    s.nHeap = 0;
+    s.k = max;
+    s.compare_info = compare_info;
+    if (km >= 0 && compare_info) {
+      nearest_points_counted(kd, 0, kd->n, &s);
+    } else if (km >= 0) {
+      nearest_points_fast(kd, 0, kd->n, &s);
+    }
+    nFound = s.nHeap;
+  } else {
+    kdRange_t s;
+    memcpy(s.pos, pos, sizeof(pos));
+    s.limit = limit;
+    s.found = NULL;
+    s.nFound = s.size = 0;
+    s.compare_info = compare_info;
+    if (km >= 0 && compare_info) {
+      points_within_counted(kd, 0, kd->n, &s);
+    } else if (km >= 0) {
+      points_within_fast(kd, 0, kd->n, &s);
+    }
+    found = s.found;
+    nFound = s.nFound;
+  }
+
+  // the slack let in points that the haversine distance may leave out
+  if (nFound > 1) {
+    qsort(found, nFound, sizeof(*found), cmpFound);
+  }
+  *matches = myMalloc((nFound ? nFound : 1) * sizeof(**matches));
+  size_t n = 0;
+  for (size_t i = 0; i < nFound; i++) {
+    const kdPoint_t *p = &kd->points[found[i].order];
+    double dist = kdHaversine(latitude, longitude, p->latitude, p->longitude);
+    if (dist <= km) {
+      (*matches)[n].data = kd->records[found[i].order];
+      (*matches)[n++].km = dist;
+    }
+  }
+  free(found);
+  return n;
+}
+
+// great-circle distance in km between two points in degrees, by the
+//    haversine formula
+double kdHaversine(double lat1, double lon1, double lat2, double lon2) {
+  double sinLat = sin((lat2 - lat1) * RADIANS / 2);
+  double sinLon = sin((lon2 - lon1) * RADIANS / 2);
+  double h = sinLat * sinLat + cos(lat1 * RADIANS) * cos(lat2 * RADIANS) * sinLon * sinLon;
+  return 2 * EARTH_RADIUS_KM * asin(sqrt(fmin(h, 1.0)));
+}
+
+// free the index, records are left to their owner
+void kdtreeFree(kdtree_t *kd) {
+  if (kd == NULL) {
+    return;
+  }
+  free(kd->nodes);
+  free(kd->records);
+  free(kd->points);
+  free(kd);
+}
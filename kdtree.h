@@ -0,0 +1,57 @@
+/*
+   kdtree.c, .h: module for a spatial index of records by latitude and
+      longitude, a k-d tree answering k-nearest-neighbour and within-radius
+      queries in great-circle (haversine) distance
+   Points are placed on the unit sphere, in x, y, z, where the straight-line
+      distance between two points grows with their great-circle distance:
+      the tree splits on those 3 axes and its bounds hold everywhere,
+      across the date line and near the poles alike.
+*/
+
+#ifndef _KDTREE_H_
+#define _KDTREE_H_
+
+#include <stddef.h>
+#include "data.h"
+#include "comparison_info.h"
+
+#define EARTH_RADIUS_KM 6371.0
+
+typedef struct kdtree kdtree_t;
+
+// a record found by a query
+typedef struct kdMatch {
+  data_t *data;
+  double km;                  // great-circle distance to the query point
+} kdMatch_t;
+
+// build the index of records[0..n-1], only the positions of lazy records
+//    are decoded; the array is copied, the records are left to their owner
+kdtree_t *kdtreeCreate(data_t **records, size_t n);
+
+// the queries below count the nodes they visit (node_accesses) and the
+//    subtrees they skip (pruned_nodes) into compare_info, or run a variant
+//    compiled without any counting when it is NULL
+
+// find the k records nearest to the point (in degrees), nearest first,
+//    equal distances in the order of the records given to kdtreeCreate()
+//    matches[] must hold k entries, return: number of matches, less than
+//    k if the index is smaller
+size_t kdtreeNearest(const kdtree_t *kd, double latitude, double longitude, size_t k,
+                     kdMatch_t *matches, comparison_info_t *compare_info);
+
+// find the records within km of the point (in degrees), ordered as by
+//    kdtreeNearest(), into *matches, a new array that the caller frees;
+//    with max > 0, only the max nearest of them are searched for
+//    return: number of matches
+size_t kdtreeWithin(const kdtree_t *kd, double latitude, double longitude, double km,
+                    size_t max, kdMatch_t **matches, comparison_info_t *compare_info);
+
+// great-circle distance in km between two points in degrees, by the
+//    haversine formula
+double kdHaversine(double lat1, double lon1, double lat2, double lon2);
+
+// free the index, records are left to their owner
+void kdtreeFree(kdtree_t *kd);
+
+#endif
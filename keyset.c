@@ -0,0 +1,109 @@
+/*
+   keyset.c, .h: module for a set of string keys, each numbered by the
+      order it was first added in; the strings are not copied
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "utils.h"
+#include "keyset.h"
+
+#define INITIAL_SIZE 64     // fewest slots of a new set, a power of 2
+
+typedef struct slot {
+  unsigned int hash;
+  int id;                   // number of the key, -1 if the slot is empty
+  char *key;
+} slot_t;
+
+struct keyset {
+  slot_t *slots;
+  size_t size;              // a power of 2, at least twice the keys
+  int n;
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// return the slot of key, or the empty slot where it goes
+static slot_t *findSlot(slot_t *slots, size_t size, const char *key,
+                        unsigned int hash) {
+  size_t mask = size - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    slot_t *slot = &slots[i];
+    if (slot->id < 0 || (slot->hash == hash && strcmp(slot->key, key) == 0)) {
+      return slot;
+    }
+  }
+}
+
+// allocate size empty slots
+static slot_t *createSlots(size_t size) {
+  slot_t *slots = myMalloc(size * sizeof(*slots));
+  for (size_t i = 0; i < size; i++) {
+    slots[i].id = -1;
+  }
+  return slots;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create an empty set, sized for about n keys
+keyset_t *keysetCreate(size_t n) {
+  keyset_t *set = myMalloc(sizeof(*set));
+  set->size = INITIAL_SIZE;
+  while (set->size < 2 * n) {
+    set->size *= 2;
+  }
+  set->slots = createSlots(set->size);
+  set->n = 0;
+  return set;
+}
+
+// add key to set if it is not there yet
+//    return: the number of key, counting from 0 in order of addition
+int keysetAdd(keyset_t *set, char *key) {
+  assert(set && key);
+  unsigned int hash = hashString(key);
+  slot_t *slot = findSlot(set->slots, set->size, key, hash);
+  if (slot->id >= 0) {
+    return slot->id;
+  }
+  slot->hash = hash;
+  slot->key = key;
+  slot->id = set->n++;
+  if (2 * (size_t) set->n > set->size) {
+    slot_t *old = set->slots;
+    size_t oldSize = set->size;
+    set->size *= 2;
+    set->slots = createSlots(set->size);
+    for (size_t i = 0; i < oldSize; i++) {
+      if (old[i].id >= 0) {
+        *findSlot(set->slots, set->size, old[i].key, old[i].hash) = old[i];
+      }
+    }
+    free(old);
+  }
+  return set->n - 1;
+}
+
+// return the number of key, or -1 if key is not in set
+int keysetFind(keyset_t *set, const char *key) {
+  assert(set && key);
+  return findSlot(set->slots, set->size, key, hashString(key))->id;
+}
+
+// number of distinct keys in set
+int keysetCount(keyset_t *set) {
+  return set->n;
+}
+
+// free set, the keys are left to their owner
+void keysetFree(keyset_t *set) {
+  if (set == NULL) {
+    return;
+  }
+  free(set->slots);
+  free(set);
+}
@@ -0,0 +1,29 @@
+/*
+   keyset.c, .h: module for a set of string keys, each numbered by the
+      order it was first added in; the strings are not copied
+*/
+
+#ifndef _KEYSET_H_
+#define _KEYSET_H_
+
+#include <stddef.h>
+
+typedef struct keyset keyset_t;
+
+// create an empty set, sized for about n keys
+keyset_t *keysetCreate(size_t n);
+
+// add key to set if it is not there yet
+//    return: the number of key, counting from 0 in order of addition
+int keysetAdd(keyset_t *set, char *key);
+
+// return the number of key, or -1 if key is not in set
+int keysetFind(keyset_t *set, const char *key);
+
+// number of distinct keys in set
+int keysetCount(keyset_t *set);
+
+// free set, the keys are left to their owner
+void keysetFree(keyset_t *set);
+
+#endif
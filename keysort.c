@@ -0,0 +1,134 @@
+/*
+   keysort.c, .h: module for sorting items by string keys, a stable
+      most-significant-digit radix sort on the key bytes whose buckets
+      are shared out to several threads
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "keysort.h"
+
+#define N_BUCKETS 256             // one per byte value, 0 for ended keys
+#define SMALL_SORT 32             // insertion sort below this many items
+#define MIN_PARALLEL (64 * 1024)  // don't bother with threads below this
+
+// buckets of the first key byte, taken one at a time by the threads
+typedef struct sortJob {
+  keyed_t *a, *tmp;
+  size_t start[N_BUCKETS + 1];    // bucket b is [start[b], start[b + 1])
+  int next;                       // next bucket to sort
+  pthread_mutex_t lock;           // guards next
+} sortJob_t;
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// stable insertion sort of a[0..n-1], whose keys share their first depth bytes
+static void insertionSort(keyed_t *a, size_t n, size_t depth) {
+  for (size_t i = 1; i < n; i++) {
+    keyed_t k = a[i];
+    size_t j = i;
+    while (j > 0 && strcmp(a[j - 1].key + depth, k.key + depth) > 0) {
+      a[j] = a[j - 1];
+      j--;
+    }
+    a[j] = k;
+  }
+}
+
+// distribute a[0..n-1] into buckets of their byte at depth, in place
+//    (through tmp), fill start[] with the bucket boundaries
+static void radixPass(keyed_t *a, keyed_t *tmp, size_t n, size_t depth,
+                      size_t *start) {
+  size_t count[N_BUCKETS] = {0};
+  for (size_t i = 0; i < n; i++) {
+    count[(unsigned char) a[i].key[depth]]++;
+  }
+  start[0] = 0;
+  for (int b = 0; b < N_BUCKETS; b++) {
+    start[b + 1] = start[b] + count[b];
+  }
+  size_t pos[N_BUCKETS];
+  memcpy(pos, start, sizeof(pos));
+  for (size_t i = 0; i < n; i++) {
+    tmp[pos[(unsigned char) a[i].key[depth]]++] = a[i];
+  }
+  memcpy(a, tmp, n * sizeof(*a));
+}
+
+// sort a[0..n-1], whose keys share their first depth bytes, tmp is scratch
+//    space of n items
+static void msdSort(keyed_t *a, keyed_t *tmp, size_t n, size_t depth) {
+  if (n < SMALL_SORT) {
+    insertionSort(a, n, depth);
+    return;
+  }
+  size_t start[N_BUCKETS + 1];
+  radixPass(a, tmp, n, depth, start);
+
+  // bucket 0 holds keys ending here: all equal, and already in order
+  for (int b = 1; b < N_BUCKETS; b++) {
+    size_t size = start[b + 1] - start[b];
+    if (size > 1) {
+      msdSort(a + start[b], tmp + start[b], size, depth + 1);
+    }
+  }
+}
+
+// sort the buckets of job until none is left
+static void *sortBuckets(void *vjob) {
+  sortJob_t *job = vjob;
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    int b = job->next++;
+    pthread_mutex_unlock(&job->lock);
+    if (b >= N_BUCKETS) {
+      return NULL;
+    }
+    size_t size = job->start[b + 1] - job->start[b];
+    if (size > 1) {
+      msdSort(job->a + job->start[b], job->tmp + job->start[b], size, 1);
+    }
+  }
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// sort a[0..n-1] by key in strcmp() order, items with equal keys keeping
+//    their order, using up to nThreads threads
+void keySort(keyed_t *a, size_t n, int nThreads) {
+  assert(nThreads > 0);
+  if (n < 2) {
+    return;
+  }
+  keyed_t *tmp = myMalloc(n * sizeof(*tmp));
+  if (nThreads == 1 || n < MIN_PARALLEL) {
+    msdSort(a, tmp, n, 0);
+    free(tmp);
+    return;
+  }
+
+  // split on the first byte, then sort the buckets in parallel
+  sortJob_t job;
+  job.a = a;
+  job.tmp = tmp;
+  job.next = 1;
+  pthread_mutex_init(&job.lock, NULL);
+  radixPass(a, tmp, n, 0, job.start);
+
+  pthread_t *threads = myMalloc(nThreads * sizeof(*threads));
+  for (int i = 0; i < nThreads; i++) {
+    if (pthread_create(&threads[i], NULL, sortBuckets, &job) != 0) {
+      error("keySort: cannot create thread");
+    }
+  }
+  for (int i = 0; i < nThreads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  free(threads);
+  pthread_mutex_destroy(&job.lock);
+  free(tmp);
+}
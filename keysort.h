@@ -0,0 +1,22 @@
+/*
+   keysort.c, .h: module for sorting items by string keys, a stable
+      most-significant-digit radix sort on the key bytes whose buckets
+      are shared out to several threads
+*/
+
+#ifndef _KEYSORT_H_
+#define _KEYSORT_H_
+
+#include <stddef.h>
+
+// an item and the key it is sorted by
+typedef struct keyed {
+  const char *key;
+  void *item;
+} keyed_t;
+
+// sort a[0..n-1] by key in strcmp() order, items with equal keys keeping
+//    their order, using up to nThreads threads
+void keySort(keyed_t *a, size_t n, int nThreads);
+
+#endif
@@ -83,12 +83,23 @@ int llistInsert(void *vll, void *data) {
     return 1;
 }
 
+// = 1 if data has key arg, for llistDeleteIf()
+static int hasKey(void *data, void *key) {
+    return dataKeyCmp(data, key, NULL) == 0;
+}
+
 // remove all record sharing "key",
 //     return number of records removed
 int llistDelete(void *vll, void *vkey) {
+    assert(vkey);
+    return llistDeleteIf(vll, hasKey, vkey);
+}
+
+// remove, in one pass, all records for which hit(data, arg) is true,
+//     return number of records removed
+int llistDeleteIf(void *vll, int (*hit)(void *data, void *arg), void *arg) {
     llist_t *ll = vll;
-    char *key = vkey;
-    assert(ll && key);
+    assert(ll && hit);
     int removals = 0;
     if (ll->head == NULL) {
         return removals;  // original list is empty, no removal possible
@@ -100,7 +111,7 @@ int llistDelete(void *vll, void *vkey) {
     while (curr != NULL) {
       lnode_t *next = curr->next;  // next node
 
-      if (dataKeyCmp(curr->data, key, NULL) == 0) {  // key found, remove the node
+      if (hit(curr->data, arg)) {    // record hit, remove the node
         if (prev == NULL) {          // removed node is head node: update head
             ll->head = curr->next;
             if (ll->head == NULL) {  // list becomes empty after removing head
@@ -120,7 +131,7 @@ int llistDelete(void *vll, void *vkey) {
 
         ll->length--;
         removals++;
-      } else {   // key not found in this node, move to the next
+      } else {   // record not hit, move to the next
           prev = curr;
       }
 
@@ -138,24 +149,26 @@ void llistPrint(void *vll, char **labels, FILE *f) {
     }
 }
 
+// the search kernel, counting comparisons (name_counted) or not (name_fast)
+#define COUNTING 1
+#include "linkedList_search.inc"
+#undef COUNTING
+#define COUNTING 0
+#include "linkedList_search.inc"
+#undef COUNTING
+
 // find all nodes in "source" having "key" and add them to the end
-//      of "target", in appearance order
+//      of "target", in appearance order, counting comparisons into
+//      compare_info unless it is NULL
 //      return number of found data
 int llistSearch(void *key, void *vsource, void *vtarget, comparison_info_t* compare_info) {
     llist_t *source = vsource;
     llist_t *target = vtarget;
     assert(source && target && key);
-    int matches = 0;
-    for (lnode_t *curr = source->head; curr; curr = curr->next) {
-        compare_info->node_accesses++; // node access +1 per accessed linked list node
-        compare_info->string_comparisons++; // even if a mismatch occurs, is 1 string comparison
-        // each character compared adds exactly 8 bits to the bit comparison count
-        if (dataKeyCmp(curr->data, key, &(compare_info->bit_comparisons)) == 0) { // found matched node
-            llistInsert(target, curr->data);
-            matches++;
-        }
+    if (compare_info) {
+        return llistSearch_counted(key, source, target, compare_info);
     }
-    return matches;
+    return llistSearch_fast(key, source, target, NULL);
 }
 
 // output whole collection in csv format
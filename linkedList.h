@@ -25,11 +25,16 @@ int llistInsert(void *ll, void *data);
 //     return number of records removed
 int llistDelete(void *ll, void *key);
 
+// remove, in one pass, all records for which hit(data, arg) is true,
+//     return number of records removed
+int llistDeleteIf(void *ll, int (*hit)(void *data, void *arg), void *arg);
+
 // print all detailed nodes to f, using "labels" for data field label
 void llistPrint(void *ll, char **labels, FILE *f);
 
 // find all nodes in "source" having "key" and add them to the end
-//      of "target", in appearance order
+//      of "target", in appearance order, counting comparisons into
+//      compare_info unless it is NULL
 //      return number of found data
 int llistSearch(void *source, void *target, void *key, comparison_info_t*);
 
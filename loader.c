@@ -0,0 +1,123 @@
+/*
+   loader.c, .h: module for parsing all records of a csv file mapped into
+      memory, splitting the work over several threads
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "loader.h"
+
+// don't bother with threads for chunks smaller than this
+#define MIN_CHUNK_SIZE (64 * 1024)
+
+// a chunk of lines and the records parsed from it
+typedef struct chunk {
+  char *pos, *end;      // the lines, end is just after a '\n' (or at EOF)
+  arena_t *arena;       // private arena of the parsing thread
+  lazySource_t *lazy;   // source of lazy records, or NULL for full records
+  intern_t *interns;    // private cache of the intern table, or NULL
+  data_t **records;     // records in file order
+  size_t n, size;       // number of records, capacity of records[]
+} chunk_t;
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// parse all lines of a chunk
+static void *parseChunk(void *vchunk) {
+  chunk_t *c = vchunk;
+  data_t *data;
+  while ((data = c->lazy ? dataParseLazyLine(&c->pos, c->end, c->arena, c->lazy)
+                         : dataParseLine(&c->pos, c->end, c->arena)) != NULL) {
+    if (c->n == c->size) {
+      c->size = c->size ? 2 * c->size : 1024;
+      c->records = myRealloc(c->records, c->size * sizeof(*c->records));
+    }
+    if (c->interns && !c->lazy) {
+      dataIntern(data, c->interns);
+    }
+    c->records[c->n++] = data;
+  }
+  return NULL;
+}
+
+// return the start of the line following position p
+static char *nextLine(char *p, char *end) {
+  char *nl = memchr(p, '\n', end - p);
+  return nl ? nl + 1 : end;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// parse all data lines in [pos, end) of a buffer returned by arenaMapFile,
+//    using up to nThreads threads, each on its own newline-aligned chunk
+//    records are allocated from arena and returned in file order, if lazy
+//    is set they are lazy records (see dataParseLazyLine)
+//    if interns is not NULL, the state and gov strings are interned in it
+//    return: malloc'ed array of records, *nRecords is set to its length
+data_t **loadRecords(char *pos, char *end, arena_t *arena, int nThreads,
+                     int lazy, intern_t *interns, size_t *nRecords) {
+  assert(pos <= end && nThreads > 0);
+  size_t len = end - pos;
+  size_t maxThreads = len / MIN_CHUNK_SIZE;
+  if ((size_t) nThreads > maxThreads) {
+    nThreads = maxThreads > 0 ? maxThreads : 1;
+  }
+
+  // split into chunks that each start at the beginning of a line
+  chunk_t *chunks = myCalloc(nThreads, sizeof(*chunks));
+  lazySource_t *source = lazy ? dataLazySource(arena, interns) : NULL;
+  char *start = pos;
+  for (int i = 0; i < nThreads; i++) {
+    chunks[i].pos = start;
+    chunks[i].end = (i == nThreads - 1) ? end
+                         : nextLine(pos + len / nThreads * (i + 1), end);
+    if (chunks[i].end < start) {
+      chunks[i].end = start;    // previous line was longer than a chunk
+    }
+    chunks[i].arena = (i == 0) ? arena : arenaCreate(ARENA_BLOCK_SIZE);
+    chunks[i].lazy = source;
+    chunks[i].interns = interns ? internCreateCache(interns) : NULL;
+    start = chunks[i].end;
+  }
+
+  if (nThreads == 1) {
+    parseChunk(&chunks[0]);
+  } else {
+    pthread_t *threads = myMalloc(nThreads * sizeof(*threads));
+    for (int i = 0; i < nThreads; i++) {
+      if (pthread_create(&threads[i], NULL, parseChunk, &chunks[i]) != 0) {
+        error("loadRecords: cannot create thread");
+      }
+    }
+    for (int i = 0; i < nThreads; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    free(threads);
+  }
+
+  // merge per-thread batches in chunk (= file) order
+  size_t n = 0;
+  for (int i = 0; i < nThreads; i++) {
+    n += chunks[i].n;
+  }
+  data_t **records = myMalloc((n ? n : 1) * sizeof(*records));
+  n = 0;
+  for (int i = 0; i < nThreads; i++) {
+    if (chunks[i].n) {
+      memcpy(records + n, chunks[i].records, chunks[i].n * sizeof(*records));
+    }
+    n += chunks[i].n;
+    free(chunks[i].records);
+    internFree(chunks[i].interns);
+    if (i > 0) {
+      arenaMerge(arena, chunks[i].arena);
+    }
+  }
+  free(chunks);
+  *nRecords = n;
+  return records;
+}
@@ -0,0 +1,21 @@
+/*
+   loader.c, .h: module for parsing all records of a csv file mapped into
+      memory, splitting the work over several threads
+*/
+
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include "data.h"
+#include "arena.h"
+
+// parse all data lines in [pos, end) of a buffer returned by arenaMapFile,
+//    using up to nThreads threads, each on its own newline-aligned chunk
+//    records are allocated from arena and returned in file order, if lazy
+//    is set they are lazy records (see dataParseLazyLine)
+//    if interns is not NULL, the state and gov strings are interned in it
+//    return: malloc'ed array of records, *nRecords is set to its length
+data_t **loadRecords(char *pos, char *end, arena_t *arena, int nThreads,
+                     int lazy, intern_t *interns, size_t *nRecords);
+
+#endif
@@ -1,23 +1,41 @@
 /*
    main.c
-   driver for Assignment 1: using linked list for dictionary
-                              operations supplied; insert, search, deleted
+   driver for a dictionary of Australian suburbs: builds the structure a task
+      needs from a csv file, then runs the queries read from stdin on it
+     Tasks:
+        2: delete names from the dictionary
+        3: search names in the dictionary (a list, hash table or trie, -d)
+        4: search names in a patricia trie, or their closest match
+        5: the k names closest to a query, in a patricia trie (-k)
+        6: the names starting with a query, in a patricia trie (-m)
+        7: the k suburbs nearest to a point, in a k-d tree (-k)
+        8: the suburbs within a distance of a point, in a k-d tree (-m)
      Compile with:
             make
-     Usage: to see usage, run:
-           ./dict1
+     Usage: ./dict3 task input_file output_file [options] < queries
+        to see usage, run:
+           ./dict3
 
      Written by Anh Vo for COMP20003 as a sample solution
         for Assignment 1, Semester 2 2024
-     Last updated: 30/07/2024
 */
 
 
+#include <unistd.h>
+#include <math.h>
 #include "utils.h"
 #include "dict.h"
 #include "data.h"
 #include "comparison_info.h"
 #include "patricia_trie.h"
+#include "arena.h"
+#include "loader.h"
+#include "snapshot.h"
+#include "executor.h"
+#include "qcache.h"
+#include "format.h"
+#include "perfstat.h"
+#include "kdtree.h"
 
 // valid tasks
 typedef enum {
@@ -25,147 +43,612 @@ typedef enum {
     LL_SEARCH = 3,  // search-on-linked-list
     PATRICIA_SEARCH = 4, // search-on-patricia-trie
     LL_DELETE = 2,  // delete-on-linked-list
+    PATRICIA_TOPK = 5,   // k closest names on patricia trie
+    PATRICIA_PREFIX = 6, // names starting with a prefix, on patricia trie
+    KD_NEAREST = 7,     // k nearest suburbs to a point, on k-d tree
+    KD_RADIUS = 8,      // suburbs within a distance of a point, on k-d tree
     // By default, enum values take the value preceeding
     //  plus one.
-    UPPER_TASK = 5      // bound
+    UPPER_TASK = 9      // bound
 } task_t;
 
 #define ARGC 4
 
-void processArgs(int argc, char *argv[], task_t *, char **, char **);
-void batchSearch(dict_t *dict, char *outFileName, FILE *msgFile);
-void batchDelete(dict_t *dict, char *outFileName, FILE *msgFile);
+// tasks searching the patricia trie
+#define TRIE_TASK(task) ((task) == PATRICIA_SEARCH || (task) == PATRICIA_TOPK \
+                         || (task) == PATRICIA_PREFIX)
 
-void batchSearch_patricia(patricia_node_t* root, char *outFileName, FILE *msgFile, char** labels);
+// tasks searching the k-d tree
+#define SPATIAL_TASK(task) ((task) == KD_NEAREST || (task) == KD_RADIUS)
+
+#define DEFAULT_TOPK 5
+
+// optional command-line settings
+typedef struct options {
+    concreteDS_t dsType;// -d list|hash|trie: data structure of the dictionary
+    int nThreads;       // -j N: number of threads used for loading and searching
+    char *snapFileName; // -s FILE: trie snapshot to reuse (or create) in tasks 4-6
+    int topK;           // -k N: number of names listed in task 5, records in task 7
+    int limit;          // -m N: records listed per query in tasks 6, 8, 0 for all
+    int pipelined;      // -p: read, search and write queries on separate threads
+    int cacheSize;      // -c N: number of query results cached, 0 for none
+    int lazy;           // -l: decode records in full only when printed
+    perfstat_t *perf;   // -t: measures of the phases and queries, or NULL
+    int counting;       // = 0 with -f: search without counting comparisons
+} options_t;
+
+void processArgs(int argc, char *argv[], task_t *, char **, char **, options_t *);
+dict_t *buildDict(char *inFileName, task_t task, options_t *options,
+                  patricia_trie_t **patricia_trie, kdtree_t **kd);
+void batchDelete(dict_t *dict, char *outFileName, FILE *msgFile, perfstat_t *perf);
+
+// what the query handlers search
+typedef struct queryCtx {
+    dict_t *dict;
+    patricia_trie_t *trie;
+    snapshot_t *snap;   // holds the trie, if not NULL
+    kdtree_t *kd;
+    char **labels;
+    int k;              // names listed by topkQuery_patricia(), records by nearestQuery()
+    int limit;          // records listed by prefixQuery_patricia() and
+                        //    radiusQuery(), 0 for all
+    qcache_t *cache;    // results of previous queries, or NULL
+    queryHandler_t handler; // what cachedQuery() runs on a cache miss
+    perfstat_t *perf;   // receives query latencies, or NULL
+    queryHandler_t timed;   // what timedQuery() runs
+    int counting;       // = 1 to count and report comparisons
+} queryCtx_t;
+
+// where prefixQuery_patricia() prints the records it is given
+typedef struct prefixOut {
+    queryCtx_t *ctx;
+    FILE *outFile;
+} prefixOut_t;
+
+void searchQuery(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void searchQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void topkQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void prefixQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void printPrefixRecord(uint32_t i, void *out);
+void nearestQuery(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void radiusQuery(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+int parsePoint(char *query, double *values, int n);
+void printPoints(FILE *outFile, kdMatch_t *matches, size_t n, char **labels);
+void printVisits(FILE *msgFile, char *query, unsigned int matches,
+                 comparison_info_t *compare_info);
+void cachedQuery(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void printMatches(FILE *msgFile, char *query, unsigned int matches,
+                  comparison_info_t *compare_info);
+void timedQuery(char *query, FILE *outFile, FILE *msgFile, void *ctx);
+void batchQueries(queryHandler_t handler, queryCtx_t *ctx, options_t *options,
+                  char *outFileName, FILE *msgFile);
 
 
 int main(int argc, char *argv[]) {
     task_t task;
     char *inFileName, *outFileName;
-    processArgs(argc, argv, &task, &inFileName, &outFileName);
-    concreteDS_t dsType = LINKED_LIST;
+    options_t options;
+    processArgs(argc, argv, &task, &inFileName, &outFileName, &options);
 
     FILE *msgFile = stdout;
-    // build linked list dictionary from csv file argv[2]
-    FILE *inFile = myFopen(inFileName, "r");
-    char **labels = dataGetLabels(inFile);            // read CSV header line
-    dict_t *dict = dictCreate(dsType, TRUE, labels);  // create empty dict
-    patricia_node_t* patricia_root = NULL;
-    void *data = NULL;
-    while ( (data = dataGetLine(inFile)) != NULL)  {
-        dictInsert(dict, data);                        // build the dataset
-        if (strcmp(argv[1], "4") == 0) { // PATRICIA_SEARCH
-            patricia_root = insert_patricia(patricia_root, ((data_t*)data)->suburbName, data);
+    dict_t *dict = NULL;
+    patricia_trie_t* patricia_trie = NULL;
+    snapshot_t *snap = NULL;
+    kdtree_t *kd = NULL;
+    if (TRIE_TASK(task) && options.snapFileName) {
+        // an up-to-date snapshot replaces loading the csv file
+        snap = snapshotOpen(options.snapFileName, inFileName);
+    }
+    if (snap == NULL) {
+        dict = buildDict(inFileName, task, &options, &patricia_trie, &kd);
+        if (TRIE_TASK(task) && options.snapFileName) {
+            snapshotWrite(options.snapFileName, inFileName, dictLabels(dict), patricia_trie);
+            snap = snapshotOpen(options.snapFileName, inFileName);
         }
-        
     }
-    fclose(inFile);
 
+    queryCtx_t ctx;
+    ctx.dict = dict;
+    ctx.trie = snap ? snapshotTrie(snap) : patricia_trie;
+    ctx.snap = snap;
+    ctx.kd = kd;
+    ctx.labels = snap ? snapshotLabels(snap) : dictLabels(dict);
+    ctx.k = options.topK;
+    ctx.limit = options.limit;
+    ctx.cache = options.cacheSize ? qcacheCreate(options.cacheSize) : NULL;
+    ctx.perf = options.perf;
+    ctx.counting = options.counting;
+    if (ctx.cache && dict) {
+        dictAttachCache(dict, ctx.cache);
+    }
 
     // do respective task
     switch (task) {
         case LL_SEARCH:
-            batchSearch(dict, outFileName, msgFile);
+            batchQueries(searchQuery, &ctx, &options, outFileName, msgFile);
             break;
         case PATRICIA_SEARCH:
-            batchSearch_patricia(patricia_root, outFileName, msgFile, labels);
+            batchQueries(searchQuery_patricia, &ctx, &options, outFileName, msgFile);
+            break;
+        case PATRICIA_TOPK:
+            batchQueries(topkQuery_patricia, &ctx, &options, outFileName, msgFile);
+            break;
+        case PATRICIA_PREFIX:
+            batchQueries(prefixQuery_patricia, &ctx, &options, outFileName, msgFile);
+            break;
+        case KD_NEAREST:
+            batchQueries(nearestQuery, &ctx, &options, outFileName, msgFile);
+            break;
+        case KD_RADIUS:
+            batchQueries(radiusQuery, &ctx, &options, outFileName, msgFile);
+            break;
         case LL_DELETE:
-            batchDelete(dict, outFileName, msgFile);
+            batchDelete(dict, outFileName, msgFile, options.perf);
             break;
         default:
             error("main: Unrecognized Task");
     }
+    if (ctx.cache) {
+        qcachePrintStats(ctx.cache, stderr);
+    }
+    perfReport(options.perf, stderr);
     // top-level cleaning
-    dictFree(dict);
-    free_all_patricia(patricia_root);
+    if (dict) {
+        dictFree(dict);
+    }
+    free_all_patricia(patricia_trie);
+    kdtreeFree(kd);
+    if (snap) {
+        snapshotClose(snap);
+    }
+    qcacheFree(ctx.cache);
+    perfFree(options.perf);
     return 0;
 }
 
-void batchSearch_patricia(patricia_node_t* root, char *outFileName, FILE *msgFile, char** labels) {
-    FILE *outFile = myFopen(outFileName, "w");
-    char *query = NULL;
-    while ( (query = getString(stdin)) != NULL) {
+// build dictionary from csv file inFileName,
+//     and also the patricia trie or the k-d tree if required by task
+dict_t *buildDict(char *inFileName, task_t task, options_t *options,
+                  patricia_trie_t **patricia_trie, kdtree_t **kd) {
+    concreteDS_t dsType = options->dsType;
+    perfBegin(options->perf, PERF_LOAD);
+    arena_t *arena = arenaCreate(ARENA_BLOCK_SIZE);   // records are bump-allocated
+    size_t inSize;                                    //    and point into the mapped file
+    char *inPos = arenaMapFile(arena, inFileName, &inSize);
+    char *inEnd = inPos + inSize;
+    char **labels = dataParseLabels(&inPos, inEnd);   // read CSV header line
+    dict_t *dict = dictCreate(dsType, TRUE, labels);  // create empty dict
+    dictAdoptArena(dict, arena);                      // freed with the dict
+    intern_t *interns = internCreate();               // state and gov strings
+    dictAdoptInterns(dict, interns);                  //    are stored once
+    size_t nRecords;
+    data_t **records = loadRecords(inPos, inEnd, arena, options->nThreads, options->lazy,
+                                   interns, &nRecords);
+    perfEnd(options->perf, PERF_LOAD);
+    perfBegin(options->perf, PERF_BUILD);
+    for (size_t i = 0; i < nRecords; i++) {
+        dictInsert(dict, records[i]);                  // build the dataset
+    }
+    if (TRIE_TASK(task)) {
+        // sort the names, file order kept for equal names, then build
+        //    the trie bottom-up in one pass
+        keyed_t *sorted = myMalloc((nRecords ? nRecords : 1) * sizeof(*sorted));
+        for (size_t i = 0; i < nRecords; i++) {
+            sorted[i].key = records[i]->suburbName;
+            sorted[i].item = records[i];
+        }
+        keySort(sorted, nRecords, options->nThreads);
+        *patricia_trie = create_patricia();
+        bulk_patricia(*patricia_trie, sorted, nRecords);
+        free(sorted);
+        layout_patricia(*patricia_trie);               // depth-first node order
+    }
+    if (SPATIAL_TASK(task)) {
+        *kd = kdtreeCreate(records, nRecords);         // decodes lazy positions only
+    }
+    perfEnd(options->perf, PERF_BUILD);
+    free(records);
+    return dict;
+}
 
-        // perform a search, then output
-        comparison_info_t compare_info = {0, 0, 0}; // Initiate comparison info
-        data_t* matches = search_patricia(root, query, &compare_info);
-        if (matches != NULL){
-            fprintf(msgFile, "%s --> 1 records - comparisons: b%d n%d s%d\n", query,
-            compare_info.bit_comparisons, compare_info.node_accesses, compare_info.string_comparisons);
-            dataPrint(matches, labels, outFile);  // print matches to file
-        } else {
-            fprintf(msgFile, "%s --> NOTFOUND\n", query);
+// search one query on the patricia trie, which is mapped from ctx->snap if not NULL
+void searchQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    patricia_trie_t *trie = ctx->trie;
+
+    // perform a search, then output
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    uint32_t matches;
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    uint32_t found = search_patricia(trie, query, &matches, counts);
+    fprintf(outFile, "%s -->\n", query);
+    if (found != PATRICIA_NONE) {
+        printMatches(msgFile, query, matches, counts);
+        for (uint32_t i = found; i < found + matches; i++) {   // print matches to file
+            data_t view;
+            dataPrint(ctx->snap ? snapshotRecord(ctx->snap, i, &view) : trie->records[i],
+                      ctx->labels, outFile);
         }
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+}
+
+// list the ctx->k names closest to one query, found in the patricia trie,
+//     which is mapped from ctx->snap if not NULL
+void topkQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    patricia_trie_t *trie = ctx->trie;
+    patricia_match_t *matches = myMalloc(ctx->k * sizeof(*matches));
 
-        fprintf(outFile, "%s -->\n", query);
-        free(query);
+    // perform a search, then output nearest first
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    uint32_t found = topk_patricia(trie, query, ctx->k, matches, counts);
+    fprintf(outFile, "%s -->\n", query);
+    uint32_t records = 0;
+    for (uint32_t i = 0; i < found; i++) {
+        // every record of a name
+        uint32_t first = matches[i].record;
+        for (uint32_t j = first; j < first + matches[i].n_records; j++) {
+            data_t view;
+            data_t *data = ctx->snap ? snapshotRecord(ctx->snap, j, &view) : trie->records[j];
+            fprintf(outFile, "Distance: %d, ", matches[i].distance);
+            dataPrint(data, ctx->labels, outFile);
+        }
+        records += matches[i].n_records;
     }
-    fclose(outFile);
+    if (found) {
+        printMatches(msgFile, query, records, counts);
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+    free(matches);
 }
 
-// do multiple search on dict, output result after each search
-// note: dict can be of any types (concrete data structures)
-void batchSearch(dict_t *dict, char *outFileName, FILE *msgFile) {
-    FILE *outFile = myFopen(outFileName, "w");
-    char *query = NULL;
-    while ( (query = getString(stdin)) != NULL) {
-        // create an empty linked list dictionary for holding search output
-        dict_t *outputDict = dictCopyStructure(dict);
-        // perform a search, then output
-        comparison_info_t compare_info = {0, 0, 0}; // Initiate comparison info
-        int matches = dictSearch(query, dict, outputDict, &compare_info);
-        if (matches){
-            fprintf(msgFile, "%s --> %d records - comparisons: b%d n%d s%d\n", query, matches,
-            compare_info.bit_comparisons, compare_info.node_accesses, compare_info.string_comparisons);
-        } else {
-            fprintf(msgFile, "%s --> NOTFOUND\n", query);
+// print record i of the trie, which is mapped from ctx->snap if not NULL
+void printPrefixRecord(uint32_t i, void *vout) {
+    prefixOut_t *out = vout;
+    data_t view;
+    dataPrint(out->ctx->snap ? snapshotRecord(out->ctx->snap, i, &view) : out->ctx->trie->records[i],
+              out->ctx->labels, out->outFile);
+}
+
+// list the records of the names starting with one query, in alphabetical
+//     order and at most ctx->limit of them, streamed from the patricia trie
+void prefixQuery_patricia(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    prefixOut_t out = {ctx, outFile};
+    fprintf(outFile, "%s -->\n", query);
+    uint32_t records = prefix_patricia(ctx->trie, query, ctx->limit, printPrefixRecord, &out, counts);
+    if (records) {
+        printMatches(msgFile, query, records, counts);
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+}
+
+// read n finite numbers, separated by spaces or commas, from query into
+//     values[], the first two a latitude and a longitude in degrees
+//     return: 1 if query holds exactly that, 0 otherwise
+int parsePoint(char *query, double *values, int n) {
+    char *pos = query, *end;
+    for (int i = 0; i < n; i++) {
+        pos += strspn(pos, " \t,");
+        values[i] = strtod(pos, &end);
+        if (end == pos || !isfinite(values[i])) {
+            return 0;
         }
+        pos = end;
+    }
+    pos += strspn(pos, " \t,");
+    return *pos == '\0' && fabs(values[0]) <= 90 && fabs(values[1]) <= 180;
+}
+
+// print matched records to outFile, nearest first, with their distances
+void printPoints(FILE *outFile, kdMatch_t *matches, size_t n, char **labels) {
+    for (size_t i = 0; i < n; i++) {
+        fprintf(outFile, "Distance: %.3f km, ", matches[i].km);
+        dataPrint(matches[i].data, labels, outFile);
+    }
+}
+
+// print the message of a k-d tree query that found "matches" records, with
+//     the nodes visited and the subtrees pruned unless they were not counted
+void printVisits(FILE *msgFile, char *query, unsigned int matches,
+                 comparison_info_t *compare_info) {
+    if (compare_info == NULL) {
+        fprintf(msgFile, "%s --> %u records\n", query, matches);
+        return;
+    }
+    fprintf(msgFile, "%s --> %u records - visits: n%d p%d\n", query, matches,
+            compare_info->node_accesses, compare_info->pruned_nodes);
+}
+
+// list the ctx->k records nearest to one query, "latitude longitude",
+//     found in the k-d tree
+void nearestQuery(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    double point[2];
+    fprintf(outFile, "%s -->\n", query);
+    if (!parsePoint(query, point, 2)) {
+        fprintf(msgFile, "%s --> INVALID, expected: latitude longitude\n", query);
+        return;
+    }
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    kdMatch_t *matches = myMalloc(ctx->k * sizeof(*matches));
+    size_t found = kdtreeNearest(ctx->kd, point[0], point[1], ctx->k, matches, counts);
+    printPoints(outFile, matches, found, ctx->labels);
+    if (found) {
+        printVisits(msgFile, query, found, counts);
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+    free(matches);
+}
+
+// list the records within a distance of one query, "latitude longitude km",
+//     found in the k-d tree, nearest first and at most ctx->limit of them
+void radiusQuery(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    double point[3];
+    fprintf(outFile, "%s -->\n", query);
+    if (!parsePoint(query, point, 3) || point[2] < 0) {
+        fprintf(msgFile, "%s --> INVALID, expected: latitude longitude km\n", query);
+        return;
+    }
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    kdMatch_t *matches;
+    size_t found = kdtreeWithin(ctx->kd, point[0], point[1], point[2], ctx->limit,
+                                &matches, counts);
+    printPoints(outFile, matches, found, ctx->labels);
+    if (found) {
+        printVisits(msgFile, query, found, counts);
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+    free(matches);
+}
+
+// search one query on ctx->dict
+// note: dict can be of any types (concrete data structures)
+void searchQuery(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    // create an empty linked list dictionary for holding search output
+    dict_t *outputDict = dictCopyStructure(ctx->dict);
+    // perform a search, then output
+    comparison_info_t compare_info = {0, 0, 0, 0}; // Initiate comparison info
+    comparison_info_t *counts = ctx->counting ? &compare_info : NULL;
+    int matches = dictSearch(query, ctx->dict, outputDict, counts);
+    if (matches){
+        printMatches(msgFile, query, matches, counts);
+    } else {
+        fprintf(msgFile, "%s --> NOTFOUND\n", query);
+    }
+
+    fprintf(outFile, "%s -->\n", query);
+    dictPrint(outputDict, outFile);
+    // cleaning after each query
+    dictFree(outputDict);
+}
+
+// print the message of a query that found "matches" records, with the
+//     comparisons made unless they were not counted
+void printMatches(FILE *msgFile, char *query, unsigned int matches,
+                  comparison_info_t *compare_info) {
+    if (compare_info == NULL) {
+        fprintf(msgFile, "%s --> %u records\n", query, matches);
+        return;
+    }
+    fprintf(msgFile, "%s --> %u records - comparisons: b%d n%d s%d\n", query, matches,
+    compare_info->bit_comparisons, compare_info->node_accesses, compare_info->string_comparisons);
+}
+
+// answer one query from ctx->cache, or with ctx->handler on a miss
+void cachedQuery(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    if (qcacheReplay(ctx->cache, query, outFile, msgFile)) {
+        return;
+    }
+    char *out, *msg;
+    size_t outLen, msgLen;
+    FILE *outBuf = open_memstream(&out, &outLen);
+    FILE *msgBuf = open_memstream(&msg, &msgLen);
+    if (outBuf == NULL || msgBuf == NULL) {
+        error("cachedQuery: cannot buffer query output");
+    }
+    ctx->handler(query, outBuf, msgBuf, ctx);
+    fclose(outBuf);
+    fclose(msgBuf);
+    fwrite(out, 1, outLen, outFile);
+    fwrite(msg, 1, msgLen, msgFile);
+    qcachePut(ctx->cache, query, out, outLen, msg, msgLen);
+}
+
+// run ctx->timed on one query, adding its latency to ctx->perf
+void timedQuery(char *query, FILE *outFile, FILE *msgFile, void *vctx) {
+    queryCtx_t *ctx = vctx;
+    double start = perfNow();
+    ctx->timed(query, outFile, msgFile, ctx);
+    perfQuery(ctx->perf, perfNow() - start);
+}
 
-        fprintf(outFile, "%s -->\n", query);
-        dictPrint(outputDict, outFile);
-        // cleaning after each query
-        dictFree(outputDict);
-        free(query);
+// do multiple queries with handler, on the threads set by options,
+//     output result of each query in input order
+void batchQueries(queryHandler_t handler, queryCtx_t *ctx, options_t *options,
+                  char *outFileName, FILE *msgFile) {
+    FILE *outFile = myFopen(outFileName, "w");
+    char *outBuffer = fmtFileBuffer(outFile);
+    if (ctx->cache) {
+        ctx->handler = handler;
+        handler = cachedQuery;
+    }
+    if (ctx->perf) {
+        ctx->timed = handler;
+        handler = timedQuery;
     }
+    perfBegin(ctx->perf, PERF_QUERY);
+    execQueries(stdin, handler, ctx, options->nThreads, options->pipelined, outFile, msgFile);
+    perfEnd(ctx->perf, PERF_QUERY);
+    perfBegin(ctx->perf, PERF_OUTPUT);
     fclose(outFile);
+    perfEnd(ctx->perf, PERF_OUTPUT);
+    free(outBuffer);
 }
 
 // do multiple record deletions on dict, output ID of the remaing records at the end
 // note: dict can be of any types
-void batchDelete(dict_t *dict, char *outFileName, FILE *msgFile) {
+void batchDelete(dict_t *dict, char *outFileName, FILE *msgFile, perfstat_t *perf) {
     char *query = NULL;
-    int recordCount = 0, queryCount = 0;
+    char **queries = NULL;
+    int queryCount = 0, querySize = 0;
 
+    // all queries are deleted together, in one pass over a list
     while ( (query = getString(stdin)) != NULL) {
-        //printf("query = %s\n", query);
-        int records = dictDelete(dict, query);
-        if (records){
-            fprintf(msgFile, "%s --> %d records deleted\n", query, records);
+        if (queryCount == querySize) {
+            querySize = querySize ? 2 * querySize : 1024;
+            queries = myRealloc(queries, querySize * sizeof(*queries));
+        }
+        queries[queryCount++] = query;
+    }
+    int *removals = myMalloc((queryCount ? queryCount : 1) * sizeof(*removals));
+    perfBegin(perf, PERF_QUERY);
+    dictDeleteBatch(dict, queries, queryCount, removals);
+    perfEnd(perf, PERF_QUERY);
+
+    for (int i = 0; i < queryCount; i++) {
+        if (removals[i]){
+            fprintf(msgFile, "%s --> %d records deleted\n", queries[i], removals[i]);
         } else {
-            fprintf(msgFile, "%s --> NOTFOUND\n", query);
+            fprintf(msgFile, "%s --> NOTFOUND\n", queries[i]);
         }
-        recordCount += records;
-        queryCount++;
-        free(query);
+        free(queries[i]);
     }
+    free(queries);
+    free(removals);
 
+    perfBegin(perf, PERF_OUTPUT);
     dictOutputCsvFile(dict, outFileName); // output remaining records
+    perfEnd(perf, PERF_OUTPUT);
 }
 
 // check arguments of main()
-void processArgs(int argc, char *argv[], task_t *task, char **inFileName, char **outFileName) {
-    if (argc < ARGC || strtol(argv[1], NULL, 10) <= (int) LOWER_TASK
+void processArgs(int argc, char *argv[], task_t *task, char **inFileName, char **outFileName,
+                 options_t *options) {
+    int opt, usage = FALSE;
+    options->dsType = LINKED_LIST;
+    options->nThreads = 1;
+    options->snapFileName = NULL;
+    options->topK = DEFAULT_TOPK;
+    options->limit = 0;
+    options->pipelined = FALSE;
+    options->cacheSize = 0;
+    options->lazy = FALSE;
+    options->perf = NULL;
+    options->counting = TRUE;
+    while ((opt = getopt(argc, argv, "c:d:fj:k:lm:ps:t")) != -1) {
+        switch (opt) {
+            case 'c':
+                options->cacheSize = strtol(optarg, NULL, 10);
+                if (options->cacheSize < 0) {
+                    usage = TRUE;
+                }
+                break;
+            case 'd':
+                if (strcmp(optarg, "list") == 0) {
+                    options->dsType = LINKED_LIST;
+                } else if (strcmp(optarg, "hash") == 0) {
+                    options->dsType = HASH_TABLE;
+                } else if (strcmp(optarg, "trie") == 0) {
+                    options->dsType = PATRICIA_TRIE;
+                } else {
+                    usage = TRUE;
+                }
+                break;
+            case 'f':
+                options->counting = FALSE;
+                break;
+            case 'j':
+                options->nThreads = strtol(optarg, NULL, 10);
+                if (options->nThreads < 1) {
+                    usage = TRUE;
+                }
+                break;
+            case 'k':
+                options->topK = strtol(optarg, NULL, 10);
+                if (options->topK < 1) {
+                    usage = TRUE;
+                }
+                break;
+            case 'l':
+                options->lazy = TRUE;
+                break;
+            case 'm':
+                options->limit = strtol(optarg, NULL, 10);
+                if (options->limit < 0) {
+                    usage = TRUE;
+                }
+                break;
+            case 'p':
+                options->pipelined = TRUE;
+                break;
+            case 's':
+                options->snapFileName = optarg;
+                break;
+            case 't':
+                if (options->perf == NULL) {
+                    options->perf = perfCreate();   // before any thread starts
+                }
+                break;
+            default:
+                usage = TRUE;
+        }
+    }
+    argc -= optind - 1;     // leave only program name and positional arguments
+    argv += optind - 1;
+    if (usage || argc < ARGC || strtol(argv[1], NULL, 10) <= (int) LOWER_TASK
                     || strtol(argv[1], NULL, 10) >= (int) UPPER_TASK)  {
         fprintf(stderr, "\n    ---- USING A DICTIONARY OF AUSTRALIAN SUBURBS ----\n");
         fprintf(stderr, "This program perform search/delete operations on a dictionary.\n");
         fprintf(stderr, "The dictionary is built from a CSV file about Australian suburbs.\n\n");
-        fprintf(stderr, "Usage: %s LOWER_TASK input_file output_file\n", argv[0]);
+        fprintf(stderr, "Usage: %s task input_file output_file [options]\n", argv[0]);
         fprintf(stderr, "       \t where:\n");
-        fprintf(stderr, "       \t    - task is 1 for search, 2 for delete\n");
+        fprintf(stderr, "       \t    - task is 2 for delete, 3 for search, 4 for search on a patricia trie,\n");
+        fprintf(stderr, "       \t      5 for the closest names on a patricia trie, 6 for the names\n");
+        fprintf(stderr, "       \t      starting with each query, in alphabetical order, 7 for the\n");
+        fprintf(stderr, "       \t      suburbs nearest to each query \"latitude longitude\", 8 for\n");
+        fprintf(stderr, "       \t      the suburbs within a distance of each \"latitude longitude km\"\n");
         fprintf(stderr, "       \t    - input_file: input CSV data file\n");
         fprintf(stderr, "       \t    - output_file: result output file\n");
+        fprintf(stderr, "Options:\n");
+        fprintf(stderr, "       -c N\t tasks 3-8: cache the results of the last N distinct queries,\n");
+        fprintf(stderr, "       \t hit and miss counts are printed to stderr (default 0: none)\n");
+        fprintf(stderr, "       -d DS\t dictionary structure for tasks 2 and 3: list (default), hash,\n");
+        fprintf(stderr, "       \t or trie (a patricia trie, which outputs records by name)\n");
+        fprintf(stderr, "       -f\t fast searches, which do not count comparisons: query messages\n");
+        fprintf(stderr, "       \t only give the number of records found\n");
+        fprintf(stderr, "       -j N\t use N threads for loading input_file and running the\n");
+        fprintf(stderr, "       \t search queries (default 1)\n");
+        fprintf(stderr, "       -l\t lazy records: load only the suburb names, the other fields\n");
+        fprintf(stderr, "       \t of a record are decoded (and checked) when it is output\n");
+        fprintf(stderr, "       -p\t read queries and write results on their own threads, so\n");
+        fprintf(stderr, "       \t that I/O overlaps with searching (implied by -j N > 1)\n");
+        fprintf(stderr, "       -k N\t task 5: list the N closest names, task 7: the N nearest\n");
+        fprintf(stderr, "       \t suburbs (default %d)\n", DEFAULT_TOPK);
+        fprintf(stderr, "       -m N\t tasks 6, 8: list at most N records per query (default 0: all)\n");
+        fprintf(stderr, "       -s FILE\t tasks 4-6: search the trie saved in snapshot FILE, which is\n");
+        fprintf(stderr, "       \t (re)built from input_file when missing or out of date\n");
+        fprintf(stderr, "       -t\t report to stderr the time, and the cycles, instructions, cache\n");
+        fprintf(stderr, "       \t and branch misses when the system allows, of the load, build,\n");
+        fprintf(stderr, "       \t query and output phases, with a histogram of query latencies\n");
         fprintf(stderr, "Notes on input queries:\n");
-        fprintf(stderr, "       each query is a suburb name in a single line\n\n");
+        fprintf(stderr, "       each query is a suburb name in a single line, or in tasks 7, 8 a\n");
+        fprintf(stderr, "       point, latitude (-90 to 90) and longitude (-180 to 180) in degrees,\n");
+        fprintf(stderr, "       and in task 8 a distance in km, separated by spaces or commas\n\n");
         exit(EXIT_FAILURE);
     }
     *task = strtol(argv[1], NULL, 10);
@@ -1,158 +1,601 @@
+#include <limits.h>
 #include "utils.h"
 #include "patricia_trie.h"
+#include "bitstring.h"
+#include "editdist.h"
 
-// root should be NULL for creating a new patricia trie
-patricia_node_t* insert_patricia(patricia_node_t* root, char* key, data_t* data) {
-	
-	// create a new patricia trie
-	if (root == NULL) {
-		patricia_node_t* node = malloc(sizeof(patricia_node_t));
-		node->prefix_bits = (strlen(key) + 1) * BITS_PER_BYTE;
-		node->prefix = strdup(key);
-		node->data = data;
-		node->branchA = NULL;
-		node->branchB = NULL;
-		return node;
-	}
-
-	// check bits match
-	unsigned int mismatch_bit = find_mismatch_bit(root->prefix, key, root->prefix_bits);
-
-	// See if All Bits Match
-	if (mismatch_bit == root->prefix_bits) {
-		
-		// See if All Bits Match, recursively
-		unsigned int next_bit = getBit(key, mismatch_bit);
-		if (next_bit == 0) {
-			root->branchA = insert_patricia(root->branchA, key, data);
-		} else {
-			root->branchB = insert_patricia(root->branchB, key, data);
+/*----- Helper functions, using only in this .c file   -----*/
+
+// make room for n more nodes, so that pointers into nodes[] stay valid
+// while up to n nodes are added
+static void reserve_nodes(patricia_trie_t* trie, uint32_t n) {
+	if (trie->n_nodes + n > trie->nodes_size) {
+		trie->nodes_size = 2 * (trie->n_nodes + n);
+		trie->nodes = myRealloc(trie->nodes, trie->nodes_size * sizeof(*trie->nodes));
+	}
+}
+
+// append bytes to the prefix pool, return their offset
+static uint32_t pool_add(patricia_trie_t* trie, const char* bytes, size_t n) {
+	if (trie->pool_len + n > trie->pool_size) {
+		trie->pool_size = 2 * (trie->pool_len + n);
+		trie->pool = myRealloc(trie->pool, trie->pool_size);
+	}
+	if (trie->pool_len + n > UINT32_MAX) {
+		error("patricia trie: prefix pool too big");
+	}
+	memcpy(trie->pool + trie->pool_len, bytes, n);
+	trie->pool_len += n;
+	return trie->pool_len - n;
+}
+
+// number of bytes holding prefix_bits bits
+static size_t prefix_bytes(unsigned int prefix_bits) {
+	return (prefix_bits + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+}
+
+// store the first prefix_bits bits of key inside node (a short prefix)
+static void set_inline_prefix(patricia_node_t* node, char* key, unsigned int prefix_bits) {
+	memset(node->prefix.bytes, 0, PATRICIA_INLINE_BYTES);
+	bitsCopy(node->prefix.bytes, key, 0, prefix_bits);
+}
+
+// find_mismatch_bit() for a key of key_bits bits (terminator included),
+// never reading past the key: a prefix that is longer than the key
+// always differs from it within the key, at its terminator at the latest
+static unsigned int mismatch_bit(const char* prefix, unsigned int prefix_bits, const char* key,
+		unsigned int key_bits) {
+	return bitsMismatch(prefix, key, prefix_bits < key_bits ? prefix_bits : key_bits);
+}
+
+// make room for n more records
+static void reserve_records(patricia_trie_t* trie, uint32_t n) {
+	if (trie->n_records + n > trie->records_size) {
+		trie->records_size = trie->records_size ? 2 * trie->records_size : 1024;
+		if (trie->records_size < trie->n_records + n) {
+			trie->records_size = trie->n_records + n;
 		}
+		trie->records = myRealloc(trie->records, trie->records_size * sizeof(*trie->records));
+	}
+}
+
+// add data to the records of leaf idx, keeping them contiguous: records not
+// at the end of records[] move there first, leaving a hole until the layout
+static void add_record(patricia_trie_t* trie, uint32_t idx, data_t* data) {
+	patricia_node_t* leaf = &trie->nodes[idx];
+	reserve_records(trie, leaf->n_records + 1);
+	if (leaf->record + leaf->n_records != trie->n_records) {
+		memmove(trie->records + trie->n_records, trie->records + leaf->record,
+				leaf->n_records * sizeof(*trie->records));
+		leaf->record = trie->n_records;
+		trie->n_records += leaf->n_records;
+	}
+	trie->records[trie->n_records++] = data;
+	leaf->n_records++;
+}
+
+// add a leaf for key (which is not yet in the trie), return its index
+static uint32_t new_leaf(patricia_trie_t* trie, char* key, data_t* data) {
+	reserve_nodes(trie, 1);
+	uint32_t idx = trie->n_nodes++;
+	patricia_node_t* node = &trie->nodes[idx];
+	size_t key_bytes = strlen(key) + 1;
+	node->prefix_bits = key_bytes * BITS_PER_BYTE;
+	node->branchA = PATRICIA_NONE;
+	node->branchB = PATRICIA_NONE;
+	if (key_bytes <= PATRICIA_INLINE_BYTES) {
+		set_inline_prefix(node, key, node->prefix_bits);
 	} else {
-		// Not in Tree Already, split node
-		patricia_node_t* new_node = malloc(sizeof(patricia_node_t));
-		new_node->prefix_bits = mismatch_bit;
-		new_node->prefix = createStem(key, 0, mismatch_bit);
-		new_node->data = NULL; // no need to store data in split node
+		node->prefix.offset = pool_add(trie, key, key_bytes);
+	}
 
-		// rearrange the Tree
-		unsigned int next_bit = getBit(key, mismatch_bit);
-		if (next_bit == 0) {
-			new_node->branchA = insert_patricia(NULL, key, data);
-			new_node->branchB = root;
-		} else {
-			new_node->branchA = root;
-			new_node->branchB = insert_patricia(NULL, key, data);
+	node->record = trie->n_records;
+	node->n_records = 0;
+	add_record(trie, idx, data);
+	return idx;
+}
+
+// copy node "idx" of trie "from" and its subtree in depth-first order into "to",
+// with the records of its leaves, return its new index; *leftmost is set to the pool offset of the first leaf
+// below, which also holds the long prefixes of all split nodes above that leaf
+static uint32_t layout_node(const patricia_trie_t* from, uint32_t idx, patricia_trie_t* to,
+		uint32_t* leftmost) {
+	if (idx == PATRICIA_NONE) {
+		return PATRICIA_NONE;
+	}
+	const patricia_node_t* node = &from->nodes[idx];
+	uint32_t new_idx = to->n_nodes++;
+	to->nodes[new_idx] = *node;
+	int is_long = prefix_bytes(node->prefix_bits) > PATRICIA_INLINE_BYTES;
+
+	if (node->record != PATRICIA_NONE) {
+		to->nodes[new_idx].record = to->n_records;
+		memcpy(to->records + to->n_records, from->records + node->record,
+				node->n_records * sizeof(*to->records));
+		to->n_records += node->n_records;
+		*leftmost = 0;
+		if (is_long) {
+			*leftmost = pool_add(to, patricia_prefix(from, node), prefix_bytes(node->prefix_bits));
+			to->nodes[new_idx].prefix.offset = *leftmost;
 		}
+		return new_idx;
+	}
 
-		return new_node;
+	uint32_t leftmost_B;
+	uint32_t a = layout_node(from, node->branchA, to, leftmost);
+	uint32_t b = layout_node(from, node->branchB, to, &leftmost_B);
+	to->nodes[new_idx].branchA = a;
+	to->nodes[new_idx].branchB = b;
+	if (is_long) {
+		to->nodes[new_idx].prefix.offset = *leftmost;
 	}
+	return new_idx;
+}
 
-	return root; 
+// apply visit() to the records of the leaves below node idx, in depth-first order
+static void walk_node(const patricia_trie_t* trie, uint32_t idx, void (*visit)(data_t*, void*), void* arg) {
+	if (idx == PATRICIA_NONE) {
+		return;
+	}
+	const patricia_node_t* node = &trie->nodes[idx];
+	if (node->record != PATRICIA_NONE) {
+		for (uint32_t i = node->record; i < node->record + node->n_records; i++) {
+			visit(trie->records[i], arg);
+		}
+		return;
+	}
+	walk_node(trie, node->branchA, visit, arg);
+	walk_node(trie, node->branchB, visit, arg);
 }
 
-// find mismatch bit, if all match, return all bits, else return the mismatch bit
-unsigned int find_mismatch_bit(char* prefix, char* key, unsigned int prefix_bits) {
+// a leaf kept by a closest match search
+typedef struct nearest {
+	uint32_t leaf;
+	int distance;
+	uint32_t order; // leaves are met in alphabetical order
+} nearest_t;
+
+// state of a closest match search, column k of columns[] holds the edit
+// distances between the first k characters of the names on the current path
+// and each prefix of the key, as the bit vectors of editdist.c, and
+// distances[k] the one to the whole key; the k best leaves so far are kept
+// in a max-heap, and as the trie is walked in alphabetical order, a name that
+// cannot beat the worst of them can only tie with names coming before it, so
+// a subtree that cannot hold a closer name is skipped
+typedef struct closest_search {
+	edpattern_t* key;
+	int n_words; // words of a column's pv[] and of its mv[]
+	uint64_t* columns; // pv[] then mv[] of each column
+	int* distances;
+	int n_columns; // columns allocated
+	nearest_t* heap; // worst leaf first
+	uint32_t n_heap, k;
+	uint32_t n_leaves; // leaves scored so far
+	comparison_info_t* compare_info;
+} closest_search_t;
+
+// = 1 if nearest a ranks after nearest b
+static int nearest_after(const nearest_t* a, const nearest_t* b) {
+	return a->distance > b->distance || (a->distance == b->distance && a->order > b->order);
+}
+
+// move heap entry i down to its place
+static void sift_down(nearest_t* heap, uint32_t n, uint32_t i) {
+	while (2 * i + 1 < n) {
+		uint32_t child = 2 * i + 1;
+		if (child + 1 < n && nearest_after(&heap[child + 1], &heap[child])) {
+			child++;
+		}
+		if (!nearest_after(&heap[child], &heap[i])) {
+			break;
+		}
+		nearest_t tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
 
-	for (unsigned int i = 0; i < prefix_bits; i++) {
-		if (getBit(prefix, i) != getBit(key, i)) {
-			return i; // return mismatch bit
+// offer a scored leaf to the search
+static void keep_nearest(closest_search_t* s, uint32_t leaf, int distance) {
+	nearest_t n = {leaf, distance, s->n_leaves++};
+	if (s->n_heap < s->k) {
+		// move up from the end
+		uint32_t i = s->n_heap++;
+		while (i > 0 && nearest_after(&n, &s->heap[(i - 1) / 2])) {
+			s->heap[i] = s->heap[(i - 1) / 2];
+			i = (i - 1) / 2;
 		}
-		return prefix_bits; // all match
+		s->heap[i] = n;
+	} else if (nearest_after(&s->heap[0], &n)) {
+		s->heap[0] = n;
+		sift_down(s->heap, s->n_heap, 0);
 	}
+}
 
+// distance a name must be under to be kept
+static int nearest_bound(const closest_search_t* s) {
+	return s->n_heap < s->k ? INT_MAX : s->heap[0].distance;
 }
 
-// search by the key, if mismatch in key, return the closest match
-data_t* search_patricia(patricia_node_t* root, char* key, comparison_info_t* compare_info) {
-	
-	if (root == NULL) {
-		return NULL;
-	}
-
-	compare_info->node_accesses++; // enter a node
-
-	// check bits match
-	unsigned int mismatch_bit = find_mismatch_bit(root->prefix, key, root->prefix_bits);
-
-	if (mismatch_bit == root->prefix_bits) {
-		
-		// see if All Bits Match, recursively
-		unsigned int next_bit = getBit(key, mismatch_bit);
-		compare_info->bit_comparisons++; // compare a bit
-
-		// search branch A and B, recursively
-		if (next_bit == 0) {
-			data_t* result = search_patricia(root->branchA, key, compare_info);
-			if (result != NULL) {
-				return result;
-			} else {
-				return root->data; // return data in current node
+// the pv[] of column k, its mv[] follows
+static uint64_t* column(const closest_search_t* s, int k) {
+	return s->columns + (size_t) k * 2 * s->n_words;
+}
+
+// fill columns from + 1 to "to" of the search, for the characters of name
+static void extend_columns(closest_search_t* s, const char* name, int from, int to) {
+	if (to >= s->n_columns) {
+		s->n_columns = 2 * (to + 1);
+		s->columns = myRealloc(s->columns, (size_t) s->n_columns * 2 * s->n_words * sizeof(*s->columns));
+		s->distances = myRealloc(s->distances, s->n_columns * sizeof(*s->distances));
+	}
+	for (int k = from + 1; k <= to; k++) {
+		const uint64_t* before = column(s, k - 1);
+		uint64_t* after = column(s, k);
+		s->distances[k] = s->distances[k - 1] + edColumnStep(s->key, before, before + s->n_words,
+				name[k - 1], after, after + s->n_words);
+	}
+}
+
+// smallest distance between the first k characters of the names on the
+// current path and a prefix of the key
+static int column_min(const closest_search_t* s, int k) {
+	const uint64_t* pv = column(s, k);
+	return edColumnMin(s->key, pv, pv + s->n_words, k);
+}
+
+// state of a prefix search, streaming the records below the node of the prefix
+typedef struct prefix_stream {
+	void (*visit)(uint32_t record, void* arg);
+	void* arg;
+	uint32_t limit; // records to visit at most
+	uint32_t n_visited;
+	comparison_info_t* compare_info;
+} prefix_stream_t;
+
+static uint32_t nearest_search(const patricia_trie_t* trie, uint32_t idx, char* key, uint32_t k,
+		patricia_match_t* matches, comparison_info_t* compare_info);
+
+// the search kernels, counting comparisons (name_counted) or not (name_fast)
+#define COUNTING 1
+#include "patricia_search.inc"
+#undef COUNTING
+#define COUNTING 0
+#include "patricia_search.inc"
+#undef COUNTING
+
+// find the k leaves below node idx closest to key, fill matches[] with them
+// from the nearest, return how many were found; comparisons are counted
+// into compare_info unless it is NULL
+static uint32_t nearest_search(const patricia_trie_t* trie, uint32_t idx, char* key, uint32_t k,
+		patricia_match_t* matches, comparison_info_t* compare_info) {
+	closest_search_t s;
+	s.key = edPatternCreate(key, strlen(key));
+	s.n_words = edPatternWords(s.key);
+	s.n_columns = 0;
+	s.columns = NULL;
+	s.distances = NULL;
+	s.heap = myMalloc((k > 0 ? k : 1) * sizeof(*s.heap));
+	s.n_heap = 0;
+	s.k = k;
+	s.n_leaves = 0;
+	s.compare_info = compare_info;
+
+	// column 0: the empty name against each prefix of the key
+	extend_columns(&s, key, 0, 0);
+	edColumnStart(s.key, column(&s, 0), column(&s, 0) + s.n_words);
+	s.distances[0] = strlen(key);
+
+	if (k > 0 && compare_info) {
+		nearest_leaves_counted(trie, idx, 0, &s);
+	} else if (k > 0) {
+		nearest_leaves_fast(trie, idx, 0, &s);
+	}
+
+	// empty the heap, worst first, into the end of matches[]
+	uint32_t found = s.n_heap;
+	while (s.n_heap > 0) {
+		nearest_t worst = s.heap[0];
+		s.heap[0] = s.heap[--s.n_heap];
+		sift_down(s.heap, s.n_heap, 0);
+		matches[s.n_heap].record = trie->nodes[worst.leaf].record;
+		matches[s.n_heap].n_records = trie->nodes[worst.leaf].n_records;
+		matches[s.n_heap].distance = worst.distance;
+	}
+	free(s.heap);
+	free(s.columns);
+	free(s.distances);
+	edPatternFree(s.key);
+	return found;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create an empty patricia trie
+patricia_trie_t* create_patricia(void) {
+	patricia_trie_t* trie = myCalloc(1, sizeof(*trie));
+	trie->root = PATRICIA_NONE;
+	return trie;
+}
+
+// insert data under key, a key already in the trie keeps its first record
+void insert_patricia(patricia_trie_t* trie, char* key, data_t* data) {
+	assert(!trie->is_mapped);
+	unsigned int key_bits = (strlen(key) + 1) * BITS_PER_BYTE;
+
+	// walk down from the root, "link" is where the subtree hangs
+	reserve_nodes(trie, 2);
+	uint32_t* link = &trie->root;
+	while (*link != PATRICIA_NONE) {
+		patricia_node_t* node = &trie->nodes[*link];
+
+		// check bits match
+		unsigned int mismatch = mismatch_bit(patricia_prefix(trie, node), node->prefix_bits, key, key_bits);
+
+		// See if All Bits Match
+		if (mismatch == node->prefix_bits) {
+
+			// whole key matched, including its terminator: the key is already
+			// stored, add to its records
+			if (mismatch == key_bits) {
+				add_record(trie, *link, data);
+				return;
 			}
+			link = bitsGet(key, mismatch) == 0 ? &node->branchA : &node->branchB;
+			continue;
+		}
+
+		// Not in Tree Already, split node
+		uint32_t leaf = new_leaf(trie, key, data);
+		uint32_t split = trie->n_nodes++;
+		patricia_node_t* new_node = &trie->nodes[split];
+		new_node->prefix_bits = mismatch;
+		new_node->record = PATRICIA_NONE; // no need to store data in split node
+		new_node->n_records = 0;
+		if (prefix_bytes(mismatch) <= PATRICIA_INLINE_BYTES) {
+			set_inline_prefix(new_node, key, mismatch);
 		} else {
-			data_t* result = search_patricia(root->branchB, key, compare_info);
-			if (result != NULL) {
-				return result;
-			} else {
-				return root->data; // return data in current node
-			}			
+			// the new, longer, key holds the prefix already
+			new_node->prefix.offset = trie->nodes[leaf].prefix.offset;
 		}
-		
-	} else if (mismatch_bit == strlen(key) * BITS_PER_BYTE) {
-		
-		// found the key
-		return root->data;
+
+		// rearrange the Tree
+		if (bitsGet(key, mismatch) == 0) {
+			new_node->branchA = leaf;
+			new_node->branchB = *link;
+		} else {
+			new_node->branchA = *link;
+			new_node->branchB = leaf;
+		}
+		*link = split;
+		return;
+	}
+	*link = new_leaf(trie, key, data);
+}
+
+// remove key and its records, applying data_free() to them if not NULL;
+//    the split node above the key is merged into its other branch
+//    return: number of records removed
+uint32_t delete_patricia(patricia_trie_t* trie, char* key, void (*data_free)(void* data)) {
+	assert(!trie->is_mapped);
+	uint32_t* parent_link;
+	uint32_t* link = find_leaf_fast(trie, key, &parent_link, NULL);
+	if (link == NULL) {
+		return 0;
+	}
+	patricia_node_t* leaf = &trie->nodes[*link];
+	uint32_t removed = leaf->n_records;
+	if (data_free) {
+		for (uint32_t i = leaf->record; i < leaf->record + leaf->n_records; i++) {
+			data_free(trie->records[i]);
+		}
+	}
+
+	// the parent only told the leaf from its sibling: the sibling, whose
+	// prefix starts from bit 0 too, takes the parent's place
+	if (parent_link == NULL) {
+		trie->root = PATRICIA_NONE;
+		trie->n_dead++;
 	} else {
+		patricia_node_t* parent = &trie->nodes[*parent_link];
+		*parent_link = (link == &parent->branchA) ? parent->branchB : parent->branchA;
+		trie->n_dead += 2;
+	}
 
-		// not match, find the closest match
-		return find_closest_match(root, key, compare_info);
+	// unlinked nodes, their records and prefixes go once they are the majority
+	if (2 * trie->n_dead > trie->n_nodes) {
+		layout_patricia(trie);
 	}
+	return removed;
 }
 
-// find the closest match, if strings have an equal distance, return alphabetically earliest
-data_t* find_closest_match(patricia_node_t* node, char* key, comparison_info_t* compare_info) {
+// build an empty trie in one pass from keys sorted in strcmp() order (see
+//    keySort), without splitting any node; the items are the records, those
+//    of a repeated key are kept in their order
+void bulk_patricia(patricia_trie_t* trie, const keyed_t* sorted, size_t n) {
+	assert(!trie->is_mapped && trie->root == PATRICIA_NONE);
+	if (n == 0) {
+		return;
+	}
+	reserve_nodes(trie, 2 * n - 1);
+	reserve_records(trie, n);
 
-	// calculate the distance of strings
-	int distance = editDistance(node->prefix, key, (node->prefix_bits) / BITS_PER_BYTE, strlen(key));
-	compare_info->string_comparisons++;
+	// stack[] holds the path from the root to the last leaf: a key can only
+	// branch off that path, to the right, at the bit where it first differs
+	// from the previous key
+	uint32_t* stack = myMalloc(2 * n * sizeof(*stack));
+	uint32_t top = 0;
+	const char* prev = sorted[0].key;
+	unsigned int prev_bits = (strlen(prev) + 1) * BITS_PER_BYTE;
+	trie->root = new_leaf(trie, (char*) prev, sorted[0].item);
+	stack[top++] = trie->root;
 
-	data_t* closest_match = node->data; // for now this is the closest
-	// find the closest in branches
-	data_t* closest_A = find_closest_match(node->branchA, key, compare_info);
-	data_t* closest_B = find_closest_match(node->branchB, key, compare_info);
+	for (size_t i = 1; i < n; i++) {
+		char* key = (char*) sorted[i].key;
+		unsigned int key_bits = (strlen(key) + 1) * BITS_PER_BYTE;
+		unsigned int mismatch = bitsMismatch(prev, key, prev_bits < key_bits ? prev_bits : key_bits);
+		if (mismatch == key_bits) {
+			// same key, the last leaf's records are at the end of records[]
+			add_record(trie, stack[top - 1], sorted[i].item);
+			continue;
+		}
+		assert(bitsGet(key, mismatch) == 1);
 
-	// calculate the distance of strings in branches
-	int distance_A = editDistance(closest_A->suburbName, key, strlen(closest_A->suburbName), strlen(key));
-	int distance_B = editDistance(closest_B->suburbName, key, strlen(closest_B->suburbName), strlen(key));
+		// nodes below the branching bit form branch A of the new split node
+		uint32_t child;
+		do {
+			child = stack[--top];
+		} while (top > 0 && trie->nodes[stack[top - 1]].prefix_bits > mismatch);
 
-	// compare distance in branches, if equal, return alphabetically earliest
-	if (distance_A < distance) {
-		closest_match = closest_A;
-	} else if (distance_A == distance) {
-		if (strcmp(closest_A->suburbName, closest_match->suburbName) < 0) {
-			closest_match = closest_A;
+		uint32_t leaf = new_leaf(trie, key, sorted[i].item);
+		uint32_t split = trie->n_nodes++;
+		patricia_node_t* new_node = &trie->nodes[split];
+		new_node->prefix_bits = mismatch;
+		new_node->record = PATRICIA_NONE;
+		new_node->n_records = 0;
+		if (prefix_bytes(mismatch) <= PATRICIA_INLINE_BYTES) {
+			set_inline_prefix(new_node, key, mismatch);
+		} else {
+			new_node->prefix.offset = trie->nodes[leaf].prefix.offset;
 		}
+		new_node->branchA = child;
+		new_node->branchB = leaf;
+		if (top > 0) {
+			trie->nodes[stack[top - 1]].branchB = split;
+		} else {
+			trie->root = split;
+		}
+		stack[top++] = split;
+		stack[top++] = leaf;
+		prev = key;
+		prev_bits = key_bits;
 	}
+	free(stack);
+}
 
-	if (distance_B < distance) {
-		closest_match = closest_B;
-	} else if (distance_B == distance) {
-		if (strcmp(closest_B->suburbName, closest_match->suburbName) < 0) {
-			closest_match = closest_B;
-		}
+// store the nodes in depth-first order, compact the prefix pool and make the
+//    records of each name contiguous, to be called once all keys are inserted
+void layout_patricia(patricia_trie_t* trie) {
+	assert(!trie->is_mapped);
+	patricia_trie_t to = *trie;
+	to.nodes_size = trie->n_nodes > 0 ? trie->n_nodes : 1;
+	to.nodes = myMalloc(to.nodes_size * sizeof(*to.nodes));
+	to.n_nodes = 0;
+	to.pool = NULL;
+	to.pool_len = to.pool_size = 0;
+	to.records_size = trie->n_records > 0 ? trie->n_records : 1;
+	to.records = myMalloc(to.records_size * sizeof(*to.records));
+	to.n_records = 0;
+	to.n_dead = 0;
+	uint32_t leftmost;
+	to.root = layout_node(trie, trie->root, &to, &leftmost);
+
+	free(trie->nodes);
+	free(trie->pool);
+	free(trie->records);
+	*trie = to;
+}
+
+// return the prefix bytes of a node
+char* patricia_prefix(const patricia_trie_t* trie, const patricia_node_t* node) {
+	if (prefix_bytes(node->prefix_bits) <= PATRICIA_INLINE_BYTES) {
+		return (char*) node->prefix.bytes;
+	}
+	return trie->pool + node->prefix.offset;
+}
+
+// find mismatch bit, if all match, return all bits, else return the mismatch bit
+unsigned int find_mismatch_bit(char* prefix, char* key, unsigned int prefix_bits) {
+	return mismatch_bit(prefix, prefix_bits, key, (strlen(key) + 1) * BITS_PER_BYTE);
+}
+
+// search by the key, if mismatch in key, return the closest match
+//    return: index of the first record of the name found, or PATRICIA_NONE,
+//    *n_records is set to the number of records of that name
+uint32_t search_patricia(const patricia_trie_t* trie, char* key, uint32_t* n_records,
+		comparison_info_t* compare_info) {
+	*n_records = 0;
+	uint32_t found = compare_info
+			? search_node_counted(trie, trie->root, key, strlen(key), n_records, compare_info)
+			: search_node_fast(trie, trie->root, key, strlen(key), n_records, NULL);
+	if (found == PATRICIA_NONE) {
+		*n_records = 0;
 	}
-	
-	return closest_match;
+	return found;
 }
 
-void free_all_patricia(patricia_node_t* root) {
-	if (root == NULL) {
+// find the records of exactly key
+//    return: index of its first record, or PATRICIA_NONE, *n_records is set
+//    to the number of its records
+uint32_t find_patricia(const patricia_trie_t* trie, char* key, uint32_t* n_records,
+		comparison_info_t* compare_info) {
+	uint32_t* parent_link;
+	uint32_t* link = compare_info
+			? find_leaf_counted((patricia_trie_t*) trie, key, &parent_link, compare_info)
+			: find_leaf_fast((patricia_trie_t*) trie, key, &parent_link, NULL);
+	if (link == NULL) {
+		*n_records = 0;
+		return PATRICIA_NONE;
+	}
+	*n_records = trie->nodes[*link].n_records;
+	return trie->nodes[*link].record;
+}
+
+// apply visit() to the records of the names starting with prefix, names in
+//    alphabetical order, the records of a name in insertion order, stopping
+//    after limit records (0 for no limit); visit() gets the index of a
+//    record in records[], so that it also works on a mapped trie
+//    return: number of records visited
+uint32_t prefix_patricia(const patricia_trie_t* trie, char* prefix, uint32_t limit,
+		void (*visit)(uint32_t record, void* arg), void* arg, comparison_info_t* compare_info) {
+	prefix_stream_t s;
+	s.visit = visit;
+	s.arg = arg;
+	s.limit = limit ? limit : UINT32_MAX;
+	s.n_visited = 0;
+	s.compare_info = compare_info;
+	unsigned int prefix_bits = strlen(prefix) * BITS_PER_BYTE;
+	if (compare_info) {
+		stream_leaves_counted(trie, find_prefix_counted(trie, prefix, prefix_bits, compare_info), &s);
+	} else {
+		stream_leaves_fast(trie, find_prefix_fast(trie, prefix, prefix_bits, NULL), &s);
+	}
+	return s.n_visited;
+}
+
+// apply visit() to every record, names in alphabetical order, the records
+//    of a name in insertion order
+void walk_patricia(const patricia_trie_t* trie, void (*visit)(data_t* data, void* arg), void* arg) {
+	walk_node(trie, trie->root, visit, arg);
+}
+
+// find the closest match below node, if strings have an equal distance, return alphabetically earliest
+uint32_t find_closest_match(const patricia_trie_t* trie, uint32_t node, char* key, comparison_info_t* compare_info) {
+	patricia_match_t match;
+	if (nearest_search(trie, node, key, 1, &match, compare_info) == 0) {
+		return PATRICIA_NONE;
+	}
+	return match.record;
+}
+
+// find the k names closest to key, nearest first, equal distances in alphabetical order
+//    matches[] must hold k entries, return: number of matches, less than k if the trie is smaller
+uint32_t topk_patricia(const patricia_trie_t* trie, char* key, uint32_t k, patricia_match_t* matches,
+		comparison_info_t* compare_info) {
+	return nearest_search(trie, trie->root, key, k, matches, compare_info);
+}
+
+// free the trie, records are left to their owner
+void free_all_patricia(patricia_trie_t* trie) {
+	if (trie == NULL) {
 		return;
 	}
-	
-	free_all_patricia(root->branchA);
-	free_all_patricia(root->branchB);
-	free(root->data);
-	free(root->prefix);
-	free(root);
-}
\ No newline at end of file
+	if (!trie->is_mapped) {
+		free(trie->nodes);
+		free(trie->pool);
+		free(trie->records);
+	}
+	free(trie);
+}
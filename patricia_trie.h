@@ -1,32 +1,119 @@
 #ifndef _PATRICIA_TRIE_H_
 #define _PATRICIA_TRIE_H_
 
+#include <stdint.h>
 #include "data.h"
 #include "comparison_info.h"
+#include "keysort.h"
 
+// no child, no record
+#define PATRICIA_NONE UINT32_MAX
+
+// prefixes up to this many bytes are stored inside the node,
+// which keeps a node at 32 bytes
+#define PATRICIA_INLINE_BYTES 12
+
+typedef struct patricia_match patricia_match_t;
 typedef struct patricia_node patricia_node_t;
+typedef struct patricia_trie patricia_trie_t;
 
+// nodes live in one array and refer to each other by index;
+// a node's prefix always starts from bit 0 of the key
 struct patricia_node {
-	unsigned int prefix_bits; // how many bits of prefix
-	char* prefix;
-	patricia_node_t* branchA; // next bit is 0
-	patricia_node_t* branchB; // nextbit is 1
-	data_t* data;
+	uint32_t prefix_bits; // how many bits of prefix
+	uint32_t branchA; // next bit is 0
+	uint32_t branchB; // nextbit is 1
+	uint32_t record; // index in records[], PATRICIA_NONE in split nodes
+	uint32_t n_records; // records of a leaf's name, stored from records[record] on
+	union {
+		char bytes[PATRICIA_INLINE_BYTES]; // short prefix
+		uint32_t offset; // long prefix, in pool
+	} prefix;
+};
+
+// a name found by a fuzzy search
+struct patricia_match {
+	uint32_t record; // index in records[] of the first record of the name
+	uint32_t n_records; // records of the name
+	int distance; // edit distance to the key
 };
 
-// root should be NULL for creating a new patricia trie
-patricia_node_t* insert_patricia(patricia_node_t* root, char* key, data_t* data);
+struct patricia_trie {
+	patricia_node_t* nodes;
+	uint32_t n_nodes, nodes_size;
+	char* pool; // bytes of long prefixes, shared by a node and its descendants
+	size_t pool_len, pool_size;
+	data_t** records; // records of the leaves, NULL when mapped from a snapshot
+	                  // (records of a name are contiguous once laid out)
+	uint32_t n_records, records_size;
+	uint32_t root;
+	uint32_t n_dead; // nodes unlinked by deletions, dropped by the next layout
+	int is_mapped; // = 1 if the arrays belong to a snapshot mapping
+};
+
+// create an empty patricia trie
+patricia_trie_t* create_patricia(void);
+
+// insert data under key, a key already in the trie gets data after its records
+void insert_patricia(patricia_trie_t* trie, char* key, data_t* data);
+
+// remove key and its records, applying data_free() to them if not NULL;
+//    the split node above the key is merged into its other branch
+//    return: number of records removed
+uint32_t delete_patricia(patricia_trie_t* trie, char* key, void (*data_free)(void* data));
+
+// build an empty trie in one pass from keys sorted in strcmp() order (see
+//    keySort), without splitting any node; the items are the records, those
+//    of a repeated key are kept in their order
+void bulk_patricia(patricia_trie_t* trie, const keyed_t* sorted, size_t n);
+
+// store the nodes in depth-first order, compact the prefix pool and make the
+//    records of each name contiguous, to be called once all keys are inserted
+void layout_patricia(patricia_trie_t* trie);
+
+// return the prefix bytes of a node
+char* patricia_prefix(const patricia_trie_t* trie, const patricia_node_t* node);
 
 // find mismatch bit, if all match, return all bits, else return the mismatch bit
 unsigned int find_mismatch_bit(char* prefix, char* key, unsigned int prefix_bits);
 
+// the searches below count their comparisons into compare_info, or run a
+//    variant compiled without any counting when it is NULL
+
 // search by the key, if mismatch in key, return the closest match
-data_t* search_patricia(patricia_node_t* root, char* key, comparison_info_t* compare_info);
+//    return: index of the first record of the name found, or PATRICIA_NONE,
+//    *n_records is set to the number of records of that name
+uint32_t search_patricia(const patricia_trie_t* trie, char* key, uint32_t* n_records,
+		comparison_info_t* compare_info);
+
+// find the records of exactly key
+//    return: index of its first record, or PATRICIA_NONE, *n_records is set
+//    to the number of its records
+uint32_t find_patricia(const patricia_trie_t* trie, char* key, uint32_t* n_records,
+		comparison_info_t* compare_info);
+
+// apply visit() to the records of the names starting with prefix, names in
+//    alphabetical order, the records of a name in insertion order, stopping
+//    after limit records (0 for no limit); visit() gets the index of a
+//    record in records[], so that it also works on a mapped trie
+//    return: number of records visited
+uint32_t prefix_patricia(const patricia_trie_t* trie, char* prefix, uint32_t limit,
+		void (*visit)(uint32_t record, void* arg), void* arg, comparison_info_t* compare_info);
+
+// apply visit() to every record, names in alphabetical order, the records
+//    of a name in insertion order
+void walk_patricia(const patricia_trie_t* trie, void (*visit)(data_t* data, void* arg), void* arg);
+
+// find the closest match below node, if strings have an equal distance, return alphabetically earliest
+uint32_t find_closest_match(const patricia_trie_t* trie, uint32_t node, char* key, comparison_info_t* compare_info);
 
-// find the closest match, if strings have an equal distance, return alphabetically earliest
-data_t* find_closest_match(patricia_node_t* node, char* key, comparison_info_t* compare_info);
+// find the k names closest to key, nearest first, equal distances in alphabetical order
+//    matches[] must hold k entries, return: number of matches, less than k if the trie is smaller
+uint32_t topk_patricia(const patricia_trie_t* trie, char* key, uint32_t k, patricia_match_t* matches,
+		comparison_info_t* compare_info);
 
-void free_all_patricia(patricia_node_t* root);
+// free the trie, records are left to their owner
+void free_all_patricia(patricia_trie_t* trie);
 
 
-#endif
\ No newline at end of file
+#endif
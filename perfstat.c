@@ -0,0 +1,242 @@
+/*
+   perfstat.c, .h: module for measuring the phases of a run and the latency
+      of its queries: wall-clock time, and with Linux perf_event_open() the
+      cycles, instructions, cache misses and branch misses of the process
+   Every function does nothing on a NULL perfstat_t, so that measuring is
+      turned on by creating one.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+#include "utils.h"
+#include "perfstat.h"
+
+#define N_COUNTERS 4
+#define N_BUCKETS 40          // latency bucket i holds [2^i, 2^(i+1)) ns
+#define BAR_WIDTH 40          // histogram bar of the fullest bucket
+
+static const char *phaseNames[PERF_PHASES] = {"load", "build", "query", "output"};
+static const char *counterNames[N_COUNTERS] = {
+  "cycles", "instructions", "cache-misses", "branch-misses"
+};
+
+struct perfstat {
+  int fds[N_COUNTERS];              // -1 for a counter not available
+  double start[PERF_PHASES];        // when the running phase started
+  uint64_t startCount[PERF_PHASES][N_COUNTERS];
+  double wall[PERF_PHASES];         // seconds, summed over the phase's runs
+  uint64_t counts[PERF_PHASES][N_COUNTERS];
+  int used[PERF_PHASES];            // = 1 if the phase was run
+
+  pthread_mutex_t lock;             // guards the latencies below
+  uint64_t buckets[N_BUCKETS];
+  uint64_t nQueries;
+  double sum, max;                  // seconds
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// open a counter of the calling process and its future threads, or return -1
+static int openCounter(int counter) {
+#ifdef __linux__
+  static const uint64_t configs[N_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+  };
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = configs[counter];
+  attr.inherit = 1;             // counts of exited threads are added
+  attr.exclude_kernel = 1;      // allowed with perf_event_paranoid <= 2
+  attr.exclude_hv = 1;
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+// read the counters into counts[]
+static void readCounters(perfstat_t *p, uint64_t *counts) {
+  for (int c = 0; c < N_COUNTERS; c++) {
+    counts[c] = 0;
+    if (p->fds[c] >= 0 && read(p->fds[c], &counts[c], sizeof(counts[c])) != sizeof(counts[c])) {
+      counts[c] = 0;
+    }
+  }
+}
+
+// upper bound, in microseconds, of latency bucket i
+static double bucketLimit(int i) {
+  return (double) ((uint64_t) 2 << i) / 1e3;
+}
+
+// upper bound, in microseconds, of the q-quantile of the latencies
+static double latencyQuantile(perfstat_t *p, double q) {
+  uint64_t rank = (uint64_t) (q * p->nQueries + 0.999999);
+  uint64_t seen = 0;
+  for (int i = 0; i < N_BUCKETS; i++) {
+    seen += p->buckets[i];
+    if (seen >= rank && seen > 0) {
+      return bucketLimit(i);
+    }
+  }
+  return p->max * 1e6;
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// start measuring; the hardware counters that cannot be opened (no
+//    permission, no PMU in a virtual machine...) are left out, the
+//    wall-clock time is always measured
+//    counters also count the threads created afterwards
+perfstat_t *perfCreate(void) {
+  perfstat_t *p = myCalloc(1, sizeof(*p));
+  for (int c = 0; c < N_COUNTERS; c++) {
+    p->fds[c] = openCounter(c);
+  }
+  pthread_mutex_init(&p->lock, NULL);
+  return p;
+}
+
+// seconds on a monotonic clock
+double perfNow(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// start, or end, a phase, a phase may be started again to add to it
+void perfBegin(perfstat_t *p, perfPhase_t phase) {
+  if (p == NULL) {
+    return;
+  }
+  assert(phase < PERF_PHASES);
+  readCounters(p, p->startCount[phase]);
+  p->start[phase] = perfNow();
+}
+
+void perfEnd(perfstat_t *p, perfPhase_t phase) {
+  if (p == NULL) {
+    return;
+  }
+  assert(phase < PERF_PHASES);
+  p->wall[phase] += perfNow() - p->start[phase];
+  uint64_t counts[N_COUNTERS];
+  readCounters(p, counts);
+  for (int c = 0; c < N_COUNTERS; c++) {
+    p->counts[phase][c] += counts[c] - p->startCount[phase][c];
+  }
+  p->used[phase] = TRUE;
+}
+
+// add a query that took "seconds" to the latency histogram, thread-safe
+void perfQuery(perfstat_t *p, double seconds) {
+  if (p == NULL) {
+    return;
+  }
+  int i = 0;
+  for (uint64_t ns = seconds * 1e9; ns > 1 && i < N_BUCKETS - 1; ns >>= 1) {
+    i++;
+  }
+  pthread_mutex_lock(&p->lock);
+  p->buckets[i]++;
+  p->nQueries++;
+  p->sum += seconds;
+  if (seconds > p->max) {
+    p->max = seconds;
+  }
+  pthread_mutex_unlock(&p->lock);
+}
+
+// write the phases and the latency histogram to f
+void perfReport(perfstat_t *p, FILE *f) {
+  if (p == NULL) {
+    return;
+  }
+  int nOpen = 0;
+  for (int c = 0; c < N_COUNTERS; c++) {
+    nOpen += p->fds[c] >= 0;
+  }
+  if (nOpen == 0) {
+    fprintf(f, "perf: hardware counters unavailable, wall-clock time only\n");
+  }
+
+  fprintf(f, "perf: %-8s %12s", "phase", "wall_ms");
+  for (int c = 0; c < N_COUNTERS; c++) {
+    if (p->fds[c] >= 0) {
+      fprintf(f, " %14s", counterNames[c]);
+    }
+  }
+  fprintf(f, "\n");
+  for (int ph = 0; ph < PERF_PHASES; ph++) {
+    if (!p->used[ph]) {
+      continue;
+    }
+    fprintf(f, "perf: %-8s %12.3f", phaseNames[ph], p->wall[ph] * 1e3);
+    for (int c = 0; c < N_COUNTERS; c++) {
+      if (p->fds[c] >= 0) {
+        fprintf(f, " %14llu", (unsigned long long) p->counts[ph][c]);
+      }
+    }
+    fprintf(f, "\n");
+  }
+  if (p->used[PERF_QUERY] && p->nQueries > 0 && nOpen > 0) {
+    fprintf(f, "perf: %-8s %12s", "/query", "");
+    for (int c = 0; c < N_COUNTERS; c++) {
+      if (p->fds[c] >= 0) {
+        fprintf(f, " %14.1f", (double) p->counts[PERF_QUERY][c] / p->nQueries);
+      }
+    }
+    fprintf(f, "\n");
+  }
+
+  if (p->nQueries == 0) {
+    return;
+  }
+  fprintf(f, "perf: %llu queries, latency mean %.3f us, p50 <= %.3f us, "
+             "p90 <= %.3f us, p99 <= %.3f us, max %.3f us\n",
+          (unsigned long long) p->nQueries, p->sum / p->nQueries * 1e6,
+          latencyQuantile(p, 0.5), latencyQuantile(p, 0.9),
+          latencyQuantile(p, 0.99), p->max * 1e6);
+  uint64_t fullest = 0;
+  for (int i = 0; i < N_BUCKETS; i++) {
+    if (p->buckets[i] > fullest) {
+      fullest = p->buckets[i];
+    }
+  }
+  for (int i = 0; i < N_BUCKETS; i++) {
+    if (p->buckets[i] == 0) {
+      continue;
+    }
+    int bar = (p->buckets[i] * BAR_WIDTH + fullest - 1) / fullest;
+    fprintf(f, "perf: < %12.3f us %10llu %.*s\n", bucketLimit(i),
+            (unsigned long long) p->buckets[i], bar,
+            "########################################");
+  }
+}
+
+// stop measuring and free p
+void perfFree(perfstat_t *p) {
+  if (p == NULL) {
+    return;
+  }
+  for (int c = 0; c < N_COUNTERS; c++) {
+    if (p->fds[c] >= 0) {
+      close(p->fds[c]);
+    }
+  }
+  pthread_mutex_destroy(&p->lock);
+  free(p);
+}
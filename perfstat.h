@@ -0,0 +1,46 @@
+/*
+   perfstat.c, .h: module for measuring the phases of a run and the latency
+      of its queries: wall-clock time, and with Linux perf_event_open() the
+      cycles, instructions, cache misses and branch misses of the process
+   Every function does nothing on a NULL perfstat_t, so that measuring is
+      turned on by creating one.
+*/
+
+#ifndef _PERFSTAT_H_
+#define _PERFSTAT_H_
+
+#include <stdio.h>
+
+typedef enum {
+  PERF_LOAD = 0,        // reading and parsing the input file
+  PERF_BUILD,           // building the dictionary and the trie
+  PERF_QUERY,           // running all queries
+  PERF_OUTPUT,          // writing what is left to write at the end
+  PERF_PHASES
+} perfPhase_t;
+
+typedef struct perfstat perfstat_t;
+
+// start measuring; the hardware counters that cannot be opened (no
+//    permission, no PMU in a virtual machine...) are left out, the
+//    wall-clock time is always measured
+//    counters also count the threads created afterwards
+perfstat_t *perfCreate(void);
+
+// seconds on a monotonic clock
+double perfNow(void);
+
+// start, or end, a phase, a phase may be started again to add to it
+void perfBegin(perfstat_t *p, perfPhase_t phase);
+void perfEnd(perfstat_t *p, perfPhase_t phase);
+
+// add a query that took "seconds" to the latency histogram, thread-safe
+void perfQuery(perfstat_t *p, double seconds);
+
+// write the phases and the latency histogram to f
+void perfReport(perfstat_t *p, FILE *f);
+
+// stop measuring and free p
+void perfFree(perfstat_t *p);
+
+#endif
@@ -0,0 +1,195 @@
+/*
+   qcache.c, .h: module for a bounded cache of query results, keyed on the
+      query string; when full, the least recently used result is dropped
+   A result is kept as the bytes that the query wrote to the output file and
+      to the message stream, so it already holds the records matched and
+      the comparison counts of the original search.
+   All operations are safe to call from several threads.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "utils.h"
+#include "qcache.h"
+
+typedef struct entry entry_t;
+struct entry {
+  char *query;
+  unsigned int hash;
+  char *out, *msg;          // the cached result
+  size_t outLen, msgLen;
+  entry_t *chain;           // next entry in the same bucket
+  entry_t *newer, *older;   // neighbours in recency order
+};
+
+struct qcache {
+  entry_t **buckets;
+  size_t nBuckets;          // a power of 2
+  size_t n, capacity;
+  entry_t *newest, *oldest;
+  size_t hits, misses, evictions, clears;
+  pthread_mutex_t lock;
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// return the link pointing to the entry of query (or to NULL)
+static entry_t **findLink(qcache_t *c, char *query, unsigned int hash) {
+  entry_t **link = &c->buckets[hash & (c->nBuckets - 1)];
+  while (*link && ((*link)->hash != hash || strcmp((*link)->query, query) != 0)) {
+    link = &(*link)->chain;
+  }
+  return link;
+}
+
+// remove e from the recency list
+static void unlinkRecent(qcache_t *c, entry_t *e) {
+  if (e->newer) {
+    e->newer->older = e->older;
+  } else {
+    c->newest = e->older;
+  }
+  if (e->older) {
+    e->older->newer = e->newer;
+  } else {
+    c->oldest = e->newer;
+  }
+}
+
+// put e at the front of the recency list
+static void pushNewest(qcache_t *c, entry_t *e) {
+  e->newer = NULL;
+  e->older = c->newest;
+  if (c->newest) {
+    c->newest->newer = e;
+  } else {
+    c->oldest = e;
+  }
+  c->newest = e;
+}
+
+static void entryFree(entry_t *e) {
+  free(e->query);
+  free(e->out);
+  free(e->msg);
+  free(e);
+}
+
+
+/*----- implementation of all funtions -----*/
+
+// create an empty cache holding up to capacity query results
+qcache_t *qcacheCreate(size_t capacity) {
+  assert(capacity > 0);
+  qcache_t *c = myCalloc(1, sizeof(*c));
+  c->nBuckets = 16;
+  while (c->nBuckets < 2 * capacity) {
+    c->nBuckets *= 2;
+  }
+  c->buckets = myCalloc(c->nBuckets, sizeof(*c->buckets));
+  c->capacity = capacity;
+  pthread_mutex_init(&c->lock, NULL);
+  return c;
+}
+
+// if the result of query is cached, write it to out and msg, and return 1;
+//    return 0 otherwise
+int qcacheReplay(qcache_t *c, char *query, FILE *out, FILE *msg) {
+  assert(c && query && out && msg);
+  unsigned int hash = hashString(query);
+  pthread_mutex_lock(&c->lock);
+  entry_t *e = *findLink(c, query, hash);
+  if (e == NULL) {
+    c->misses++;
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+  }
+  c->hits++;
+  unlinkRecent(c, e);
+  pushNewest(c, e);
+  fwrite(e->out, 1, e->outLen, out);
+  fwrite(e->msg, 1, e->msgLen, msg);
+  pthread_mutex_unlock(&c->lock);
+  return 1;
+}
+
+// cache the result of query: the outLen bytes of out and msgLen bytes of msg,
+//    which must be malloc'ed and are freed by the cache
+void qcachePut(qcache_t *c, char *query, char *out, size_t outLen,
+               char *msg, size_t msgLen) {
+  assert(c && query && out && msg);
+  unsigned int hash = hashString(query);
+  pthread_mutex_lock(&c->lock);
+  entry_t **link = findLink(c, query, hash);
+  if (*link) {
+    // cached meanwhile by another thread
+    pthread_mutex_unlock(&c->lock);
+    free(out);
+    free(msg);
+    return;
+  }
+
+  entry_t *e = myMalloc(sizeof(*e));
+  e->query = myStrdup(query);
+  e->hash = hash;
+  e->out = out;
+  e->outLen = outLen;
+  e->msg = msg;
+  e->msgLen = msgLen;
+  e->chain = NULL;
+  *link = e;
+  pushNewest(c, e);
+  c->n++;
+
+  if (c->n > c->capacity) {
+    entry_t *old = c->oldest;
+    unlinkRecent(c, old);
+    link = findLink(c, old->query, old->hash);
+    *link = old->chain;
+    entryFree(old);
+    c->n--;
+    c->evictions++;
+  }
+  pthread_mutex_unlock(&c->lock);
+}
+
+// drop all cached results, when the searched data changes
+void qcacheClear(qcache_t *c) {
+  assert(c);
+  pthread_mutex_lock(&c->lock);
+  entry_t *e = c->newest;
+  while (e) {
+    entry_t *tmp = e;
+    e = e->older;
+    entryFree(tmp);
+  }
+  memset(c->buckets, 0, c->nBuckets * sizeof(*c->buckets));
+  c->newest = c->oldest = NULL;
+  c->n = 0;
+  c->clears++;
+  pthread_mutex_unlock(&c->lock);
+}
+
+// print the numbers of hits, misses, evictions and clears to f
+void qcachePrintStats(qcache_t *c, FILE *f) {
+  assert(c && f);
+  pthread_mutex_lock(&c->lock);
+  size_t lookups = c->hits + c->misses;
+  fprintf(f, "query cache: %zu hits, %zu misses (%.1f%% hits), %zu evictions, %zu clears\n",
+          c->hits, c->misses, lookups ? 100.0 * c->hits / lookups : 0.0,
+          c->evictions, c->clears);
+  pthread_mutex_unlock(&c->lock);
+}
+
+// free the cache and all its results
+void qcacheFree(qcache_t *c) {
+  if (c == NULL) {
+    return;
+  }
+  qcacheClear(c);
+  pthread_mutex_destroy(&c->lock);
+  free(c->buckets);
+  free(c);
+}
@@ -0,0 +1,38 @@
+/*
+   qcache.c, .h: module for a bounded cache of query results, keyed on the
+      query string; when full, the least recently used result is dropped
+   A result is kept as the bytes that the query wrote to the output file and
+      to the message stream, so it already holds the records matched and
+      the comparison counts of the original search.
+   All operations are safe to call from several threads.
+*/
+
+#ifndef _QCACHE_H_
+#define _QCACHE_H_
+
+#include <stdio.h>
+
+typedef struct qcache qcache_t;
+
+// create an empty cache holding up to capacity query results
+qcache_t *qcacheCreate(size_t capacity);
+
+// if the result of query is cached, write it to out and msg, and return 1;
+//    return 0 otherwise
+int qcacheReplay(qcache_t *cache, char *query, FILE *out, FILE *msg);
+
+// cache the result of query: the outLen bytes of out and msgLen bytes of msg,
+//    which must be malloc'ed and are freed by the cache
+void qcachePut(qcache_t *cache, char *query, char *out, size_t outLen,
+               char *msg, size_t msgLen);
+
+// drop all cached results, when the searched data changes
+void qcacheClear(qcache_t *cache);
+
+// print the numbers of hits, misses, evictions and clears to f
+void qcachePrintStats(qcache_t *cache, FILE *f);
+
+// free the cache and all its results
+void qcacheFree(qcache_t *cache);
+
+#endif
@@ -0,0 +1,335 @@
+/*
+   snapshot.c, .h: module for saving a patricia trie, together with its
+      records and the csv labels, to a binary file, and for searching that
+      file directly after mapping it read-only into memory
+   The trie's node array and prefix pool are saved as they are: all links
+      are indices or offsets, so the mapped image is used without any fixup.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "snapshot.h"
+
+#define SNAP_MAGIC "PATSNAP"
+#define SNAP_ENDIAN 0x01020304u   // reads differently on a foreign byte order
+
+// file layout: header, records[], trie nodes[], trie prefix pool, string pool
+typedef struct snapHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  uint64_t fileSize;
+  uint64_t checksum;          // of the whole file, with this field zeroed
+  uint64_t csvSize;           // source csv, to detect a stale snapshot
+  int64_t csvMtimeSec;
+  int64_t csvMtimeNsec;
+  uint32_t nRecords;
+  uint32_t nNodes;
+  uint32_t root;              // index of the root node, or PATRICIA_NONE
+  uint32_t labels[COLS];      // offsets of the csv labels in the string pool
+  uint64_t recordsOff;        // file offsets of the sections
+  uint64_t nodesOff;
+  uint64_t poolOff;
+  uint64_t poolSize;
+  uint64_t stringsOff;
+  uint64_t stringsSize;
+} snapHeader_t;
+
+typedef struct snapRecord {
+  int32_t recId;
+  int32_t suburbCode;
+  int32_t year;
+  uint32_t suburbName;        // offsets in the string pool
+  uint32_t stateCode;
+  uint32_t stateName;
+  uint32_t govCode;
+  uint32_t govName;
+  double latitude;
+  double longitude;
+} snapRecord_t;
+
+struct snapshot {
+  char *base;                 // the mapped file
+  size_t size;
+  snapHeader_t *header;
+  snapRecord_t *records;
+  char *strings;
+  patricia_trie_t trie;       // view of the mapped trie
+  char *labels[COLS + 1];
+};
+
+/*----- Helper functions, using only in this .c file   -----*/
+
+// growable byte buffer for building the file sections
+typedef struct sbuf {
+  char *mem;
+  size_t len, size;
+} sbuf_t;
+
+static size_t sbufAppend(sbuf_t *b, const void *p, size_t n) {
+  if (b->len + n > b->size) {
+    b->size = 2 * (b->len + n) + 1024;
+    b->mem = myRealloc(b->mem, b->size);
+  }
+  memcpy(b->mem + b->len, p, n);
+  b->len += n;
+  return b->len - n;
+}
+
+static uint32_t addString(sbuf_t *strings, const char *s, size_t n) {
+  size_t off = sbufAppend(strings, s, n);
+  if (off + n > UINT32_MAX) {
+    error("snapshotWrite: string pool too big");
+  }
+  return off;
+}
+
+static uint32_t addRecord(sbuf_t *records, sbuf_t *strings, data_t *data) {
+  snapRecord_t r;
+  memset(&r, 0, sizeof(r));
+  dataMaterialize(data);
+  r.recId = data->recId;
+  r.suburbCode = data->suburbCode;
+  r.year = data->year;
+  r.suburbName = addString(strings, data->suburbName, strlen(data->suburbName) + 1);
+  r.stateCode = addString(strings, data->stateCode, strlen(data->stateCode) + 1);
+  r.stateName = addString(strings, data->stateName, strlen(data->stateName) + 1);
+  r.govCode = addString(strings, data->govCode, strlen(data->govCode) + 1);
+  r.govName = addString(strings, data->govName, strlen(data->govName) + 1);
+  r.latitude = data->latitude;
+  r.longitude = data->longitude;
+  return sbufAppend(records, &r, sizeof(r)) / sizeof(r);
+}
+
+// continue hash h over the n bytes at vp
+static uint64_t checksumAdd(uint64_t h, const void *vp, size_t n) {
+  const unsigned char *p = vp;
+  for (; n >= sizeof(uint64_t); n -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    h = (h ^ w) * 0x100000001b3ULL;
+    h ^= h >> 29;
+  }
+  for (; n > 0; n--, p++) {
+    h = (h ^ *p) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+// checksum of the file image of size bytes, as if its checksum were 0
+static uint64_t checksum(const char *image, size_t size) {
+  snapHeader_t h;
+  memcpy(&h, image, sizeof(h));
+  h.checksum = 0;
+  uint64_t sum = checksumAdd(0xcbf29ce484222325ULL, &h, sizeof(h));
+  return checksumAdd(sum, image + sizeof(h), size - sizeof(h));
+}
+
+static size_t alignUp(size_t n) {
+  return (n + 7) & ~(size_t) 7;
+}
+
+// = 1 if the string pool ends a string and the labels start within it
+static int stringsTerminated(const snapHeader_t *h, const char *base) {
+  if (h->stringsSize == 0 || base[h->fileSize - 1] != '\0') {
+    return 0;
+  }
+  for (int i = 0; i < COLS; i++) {
+    if (h->labels[i] >= h->stringsSize) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static char *snapString(snapshot_t *snap, uint32_t off) {
+  return snap->strings + off;
+}
+
+/*----- implementation of all funtions -----*/
+
+// write trie and the records it holds to file snapFileName,
+//    stamped with the size and modification time of csvFileName
+void snapshotWrite(char *snapFileName, char *csvFileName, char **labels,
+                   patricia_trie_t *trie) {
+  struct stat st;
+  if (stat(csvFileName, &st) != 0) {
+    error("snapshotWrite: cannot stat csv file");
+  }
+
+  sbuf_t records = {NULL, 0, 0}, strings = {NULL, 0, 0};
+  snapHeader_t h;
+  memset(&h, 0, sizeof(h));
+  for (int i = 0; i < COLS; i++) {
+    h.labels[i] = addString(&strings, labels[i], strlen(labels[i]) + 1);
+  }
+  for (uint32_t i = 0; i < trie->n_records; i++) {
+    addRecord(&records, &strings, trie->records[i]);
+  }
+  size_t nodesLen = (size_t) trie->n_nodes * sizeof(*trie->nodes);
+  h.root = trie->root;
+
+  memcpy(h.magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+  h.version = SNAPSHOT_VERSION;
+  h.endian = SNAP_ENDIAN;
+  h.csvSize = st.st_size;
+  h.csvMtimeSec = st.st_mtim.tv_sec;
+  h.csvMtimeNsec = st.st_mtim.tv_nsec;
+  h.nRecords = trie->n_records;
+  h.nNodes = trie->n_nodes;
+  h.recordsOff = alignUp(sizeof(h));
+  h.nodesOff = alignUp(h.recordsOff + records.len);
+  h.poolOff = alignUp(h.nodesOff + nodesLen);
+  h.poolSize = trie->pool_len;
+  h.stringsOff = alignUp(h.poolOff + trie->pool_len);
+  h.stringsSize = strings.len;
+  h.fileSize = h.stringsOff + strings.len;
+
+  char *image = myCalloc(1, h.fileSize);
+  if (records.len) {
+    memcpy(image + h.recordsOff, records.mem, records.len);
+  }
+  if (nodesLen) {
+    memcpy(image + h.nodesOff, trie->nodes, nodesLen);
+  }
+  if (trie->pool_len) {
+    memcpy(image + h.poolOff, trie->pool, trie->pool_len);
+  }
+  memcpy(image + h.stringsOff, strings.mem, strings.len);
+  memcpy(image, &h, sizeof(h));
+  h.checksum = checksum(image, h.fileSize);
+  memcpy(image, &h, sizeof(h));
+
+  // write to a private file, then rename: readers never see half a snapshot
+  char *tmpName = myMalloc(strlen(snapFileName) + 32);
+  sprintf(tmpName, "%s.tmp.%ld", snapFileName, (long) getpid());
+  FILE *f = myFopen(tmpName, "wb");
+  if (fwrite(image, 1, h.fileSize, f) != h.fileSize || fclose(f) != 0
+      || rename(tmpName, snapFileName) != 0) {
+    unlink(tmpName);
+    warning("snapshotWrite: cannot write snapshot");
+  }
+
+  free(tmpName);
+  free(image);
+  free(records.mem);
+  free(strings.mem);
+}
+
+// map file snapFileName, return NULL (with a warning) if it does not exist,
+//    is corrupted, has another version, or was not built from the current
+//    content of csvFileName
+snapshot_t *snapshotOpen(char *snapFileName, char *csvFileName) {
+  int fd = open(snapFileName, O_RDONLY);
+  if (fd < 0) {
+    if (errno != ENOENT) {
+      warning("snapshotOpen: cannot open snapshot, rebuilding it");
+    }
+    return NULL;
+  }
+  struct stat st, csv;
+  char *base = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(snapHeader_t)) {
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (base == MAP_FAILED) {
+    warning("snapshotOpen: cannot map snapshot, rebuilding it");
+    return NULL;
+  }
+
+  snapHeader_t *h = (snapHeader_t *) base;
+  char *problem = NULL;
+  if (memcmp(h->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0
+      || h->endian != SNAP_ENDIAN) {
+    problem = "snapshotOpen: not a snapshot file, rebuilding it";
+  } else if (h->version != SNAPSHOT_VERSION) {
+    problem = "snapshotOpen: snapshot version mismatch, rebuilding it";
+  } else if (h->fileSize != (uint64_t) st.st_size
+             || h->recordsOff < sizeof(*h)
+             || h->recordsOff + (uint64_t) h->nRecords * sizeof(snapRecord_t) > h->nodesOff
+             || h->nodesOff + (uint64_t) h->nNodes * sizeof(patricia_node_t) > h->poolOff
+             || h->poolOff + h->poolSize > h->stringsOff
+             || h->stringsOff + h->stringsSize != h->fileSize
+             || (h->root >= h->nNodes && h->root != PATRICIA_NONE)
+             || !stringsTerminated(h, base)
+             || checksum(base, h->fileSize) != h->checksum) {
+    problem = "snapshotOpen: snapshot is corrupted, rebuilding it";
+  } else if (stat(csvFileName, &csv) != 0 || (uint64_t) csv.st_size != h->csvSize
+             || csv.st_mtim.tv_sec != h->csvMtimeSec
+             || csv.st_mtim.tv_nsec != h->csvMtimeNsec) {
+    problem = "snapshotOpen: csv file changed since snapshot, rebuilding it";
+  }
+  if (problem) {
+    warning(problem);
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  snapshot_t *snap = myMalloc(sizeof(*snap));
+  snap->base = base;
+  snap->size = st.st_size;
+  snap->header = h;
+  snap->records = (snapRecord_t *) (base + h->recordsOff);
+  snap->strings = base + h->stringsOff;
+  memset(&snap->trie, 0, sizeof(snap->trie));
+  snap->trie.nodes = (patricia_node_t *) (base + h->nodesOff);
+  snap->trie.n_nodes = snap->trie.nodes_size = h->nNodes;
+  snap->trie.pool = base + h->poolOff;
+  snap->trie.pool_len = snap->trie.pool_size = h->poolSize;
+  snap->trie.records = NULL;
+  snap->trie.n_records = snap->trie.records_size = h->nRecords;
+  snap->trie.root = h->root;
+  snap->trie.is_mapped = TRUE;
+  for (int i = 0; i < COLS; i++) {
+    snap->labels[i] = snapString(snap, h->labels[i]);
+  }
+  snap->labels[COLS] = NULL;
+  return snap;
+}
+
+// NULL-terminated array of csv labels stored in the snapshot
+char **snapshotLabels(snapshot_t *snap) {
+  return snap->labels;
+}
+
+// the saved trie, its nodes and pool are in the mapped file, its records[]
+//    is NULL: use snapshotRecord() to get the records it refers to
+patricia_trie_t *snapshotTrie(snapshot_t *snap) {
+  return &snap->trie;
+}
+
+// fill *view with the record of index idx (its strings point into the
+//    snapshot), return view
+data_t *snapshotRecord(snapshot_t *snap, uint32_t idx, data_t *view) {
+  assert(idx < snap->header->nRecords);
+  snapRecord_t *r = &snap->records[idx];
+  view->recId = r->recId;
+  view->suburbCode = r->suburbCode;
+  view->suburbName = snapString(snap, r->suburbName);
+  view->year = r->year;
+  view->stateCode = snapString(snap, r->stateCode);
+  view->stateName = snapString(snap, r->stateName);
+  view->govCode = snapString(snap, r->govCode);
+  view->govName = snapString(snap, r->govName);
+  view->latitude = r->latitude;
+  view->longitude = r->longitude;
+  view->isArena = TRUE;       // not to be freed
+  view->isInterned = FALSE;
+  view->lazy = NULL;
+  return view;
+}
+
+// unmap and free the snapshot
+void snapshotClose(snapshot_t *snap) {
+  munmap(snap->base, snap->size);
+  free(snap);
+}
@@ -0,0 +1,45 @@
+/*
+   snapshot.c, .h: module for saving a patricia trie, together with its
+      records and the csv labels, to a binary file, and for searching that
+      file directly after mapping it read-only into memory
+   The trie's node array and prefix pool are saved as they are: all links
+      are indices or offsets, so the mapped image is used without any fixup.
+*/
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "data.h"
+#include "patricia_trie.h"
+#include "comparison_info.h"
+
+// bump when the file layout changes
+#define SNAPSHOT_VERSION 3
+
+typedef struct snapshot snapshot_t;
+
+// write trie and the records it holds to file snapFileName,
+//    stamped with the size and modification time of csvFileName
+void snapshotWrite(char *snapFileName, char *csvFileName, char **labels,
+                   patricia_trie_t *trie);
+
+// map file snapFileName, return NULL (with a warning) if it does not exist,
+//    is corrupted, has another version, or was not built from the current
+//    content of csvFileName
+snapshot_t *snapshotOpen(char *snapFileName, char *csvFileName);
+
+// NULL-terminated array of csv labels stored in the snapshot
+char **snapshotLabels(snapshot_t *snap);
+
+// the saved trie, its nodes and pool are in the mapped file, its records[]
+//    is NULL: use snapshotRecord() to get the records it refers to
+patricia_trie_t *snapshotTrie(snapshot_t *snap);
+
+// fill *view with the record of index idx (its strings point into the
+//    snapshot), return view
+data_t *snapshotRecord(snapshot_t *snap, uint32_t idx, data_t *view);
+
+// unmap and free the snapshot
+void snapshotClose(snapshot_t *snap);
+
+#endif
@@ -0,0 +1,75 @@
+#!/bin/bash
+# test_tasks.sh: run the tasks on the test datasets, with the options that
+#    must not change their results, and compare the output files and the
+#    messages written to stdout with the expected ones
+# usage: ./test_tasks.sh [program], the program is ./dict3 by default
+#    (see "make test"); exits with the number of failed runs
+PROG=${1:-./dict3}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+failed=0
+
+# check NAME EXPECTED_OUT EXPECTED_STDOUT TASK DATASET QUERIES [OPTIONS...]
+check() {
+    local name=$1 out=$2 stdout=$3 task=$4 data=$5 queries=$6
+    shift 6
+    "$PROG" $task tests/$data.csv $OUT/$name.out "$@" < tests/$queries.in \
+        > $OUT/$name.stdout.out 2> /dev/null
+    if cmp -s $out $OUT/$name.out && cmp -s $stdout $OUT/$name.stdout.out; then
+        echo "passed: $name"
+    else
+        echo "FAILED: $name ($PROG $task tests/$data.csv ... $* < tests/$queries.in)"
+        failed=$((failed + 1))
+    fi
+}
+
+# task 3: the records found do not depend on the structure or the options,
+#    the comparison counts do
+for i in 1 15 100 1000; do
+    s3=matching_results/test$i.s3
+    check test$i.s3 $s3.out $s3.stdout.out 3 dataset_$i test$i
+    check test$i.s3.j4 $s3.out $s3.stdout.out 3 dataset_$i test$i -j 4
+    check test$i.s3.lazy $s3.out $s3.stdout.out 3 dataset_$i test$i -l
+    check test$i.s3.pipe $s3.out $s3.stdout.out 3 dataset_$i test$i -p -c 8
+done
+s3=matching_results/test1000.s3
+check test1000.s3.hash $s3.out expected/test1000.s3.hash.stdout.out 3 dataset_1000 test1000 -d hash
+check test1000.s3.trie $s3.out expected/test1000.s3.trie.stdout.out 3 dataset_1000 test1000 -d trie
+check test1000.s3.fast $s3.out expected/test1000.s3.fast.stdout.out 3 dataset_1000 test1000 -f
+
+# task 2: the trie deletes the same records, but outputs them by name
+for i in 1 2 3; do
+    s2=expected/del$i.s2
+    check del$i.s2 expected/del$i.out $s2.stdout.out 2 dataset_del del$i
+    check del$i.s2.j4 expected/del$i.out $s2.stdout.out 2 dataset_del del$i -j 4 -l
+    check del$i.s2.hash expected/del$i.out $s2.stdout.out 2 dataset_del del$i -d hash
+    check del$i.s2.trie $s2.trie.out $s2.stdout.out 2 dataset_del del$i -d trie
+done
+
+# task 4, also from a snapshot: written by the first run, read by the second
+s4=expected/test1000.s4
+check test1000.s4 $s4.out $s4.stdout.out 4 dataset_1000 test1000
+check test1000.s4.j4 $s4.out $s4.stdout.out 4 dataset_1000 test1000 -j 4 -l
+check test1000.s4.snap $s4.out $s4.stdout.out 4 dataset_1000 test1000 -s $OUT/snap
+check test1000.s4.mapped $s4.out $s4.stdout.out 4 dataset_1000 test1000 -s $OUT/snap
+
+# task 5: the closest names, with a key longer than 64 characters
+check task5 expected/task5.out expected/task5.stdout.out 5 dataset_1000 task5
+check task5.k3 expected/task5.k3.out expected/task5.k3.stdout.out 5 dataset_1000 task5 -k 3
+check task5.j4 expected/task5.out expected/task5.stdout.out 5 dataset_1000 task5 -j 4 -l -c 4
+check task5.snap expected/task5.out expected/task5.stdout.out 5 dataset_1000 task5 -s $OUT/snap
+
+# task 6: the records of the names starting with a query, all or the first 3
+check task6 expected/task6.out expected/task6.stdout.out 6 dataset_1000 task6
+check task6.m3 expected/task6.m3.out expected/task6.m3.stdout.out 6 dataset_1000 task6 -m 3
+check task6.snap expected/task6.m3.out expected/task6.m3.stdout.out 6 dataset_1000 task6 -m 3 -s $OUT/snap
+
+# tasks 7 and 8: the nearest records, and the records within a distance,
+#    all or the 2 nearest; points out of range are invalid queries
+check task7 expected/task7.out expected/task7.stdout.out 7 dataset_1000 task7 -k 3
+check task7.j4 expected/task7.out expected/task7.stdout.out 7 dataset_1000 task7 -k 3 -j 4 -l
+check task8 expected/task8.out expected/task8.stdout.out 8 dataset_1000 task8
+check task8.m2 expected/task8.m2.out expected/task8.m2.stdout.out 8 dataset_1000 task8 -m 2
+check task8.j4 expected/task8.out expected/task8.stdout.out 8 dataset_1000 task8 -j 4 -l -c 4
+
+exit $failed
@@ -11,7 +11,9 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <limits.h>
 #include "utils.h"
+#include "bitstring.h"
 
 
 // dynamic memory tools
@@ -51,58 +53,203 @@ char *myStrdup(char *source) {
     return target;
 }
 
-// get string until encountering a comma or newline
-// cut-off and ignore from maxLength-th char if applicable
-char *getCsvString(FILE *f) {
-    int ch;
-    char scanch;
-    if (fscanf(f, " %c", &scanch) != 1) {
+// FNV-1a hash of a string
+unsigned int hashString(const char *s) {
+    unsigned int h = 2166136261u;
+    for (; *s; s++) {
+        h = (h ^ (unsigned char) *s) * 16777619u;
+    }
+    return h;
+}
+
+/*--------- parsing a csv file mapped into memory  -----------*/
+
+#define INT_DIGITS 9        // digits that always fit in an int
+
+// skip white spaces
+static void skipSpaces(char **pos, char *end) {
+    char *p = *pos;
+    while (p < end && isspace((unsigned char) *p)) {
+        p++;
+    }
+    *pos = p;
+}
+
+// find the csv string field at *pos, quoted or ended by a comma or newline,
+//    and advance *pos past it; *stop is set to where the field stops
+//    return: the start of the field, NULL at the end of the buffer
+static char *scanCsvString(char **pos, char *end, char **stop) {
+    skipSpaces(pos, end);
+    char *p = *pos;
+    if (p >= end) {
         return NULL;
     }
-    ch = scanch;
-    int i;
-    int tooLong = FALSE;
-    char *s = myMalloc((MAX_STR_LEN + 1) * sizeof(*s));
-    char *p = s;
-    if (ch == '\"') {
-        for (i = 0; (ch = fgetc(f)) != EOF
-                   && ch != '\"' 
-                   && ch != '\n' 
-                   && ch != '\r'; i++) {
-            if (i < MAX_STR_LEN){
-                *(p++) = ch;
-            } else {
-                tooLong = TRUE;
-            }
+    char *s;
+    if (*p == '\"') {
+        s = ++p;
+        while (p < end && *p != '\"' && *p != '\n' && *p != '\r') {
+            p++;
         }
-        if (ch == '\"') {
-            ch = fgetc(f);   // consume comma (or \n)
+        *stop = p;
+        if (p < end && *p == '\"') {
+            p++;       // consume comma (or \n)
         }
-    } else if (ch != EOF && ch != ',' && ch != '\n' && ch != '\r') {
-                                       // also account for empty string
-        *(p++) = ch;
-        for (i = 1; (ch = fgetc(f)) != EOF 
-            && ch != ','
-            && ch != '\n'
-            && ch != '\r'; i++) {
-            if (i < MAX_STR_LEN){
-                *(p++) = ch;
-            } else {
-                tooLong = TRUE;
-            }
+    } else {
+        s = p;
+        while (p < end && *p != ',' && *p != '\n' && *p != '\r') {
+            p++;
         }
+        *stop = p;
+    }
+    if (p < end) {
+        p++;           // consume the terminator
     }
-    if (tooLong) {
+    *pos = p;
+    return s;
+}
+
+// get a csv string field, quoted or ended by a comma or newline, cut-off
+//    from the MAX_STR_LEN-th char if applicable; the field is terminated
+//    in place with '\0' and a pointer into the buffer is returned, the
+//    buffer must have a writable byte at "end"
+char *parseCsvString(char **pos, char *end) {
+    char *stop;
+    char *s = scanCsvString(pos, end, &stop);
+    if (s == NULL) {
+        return NULL;
+    }
+    if (stop - s > MAX_STR_LEN) {
         warning("getCsvString: too-long string chopped");
+        stop = s + MAX_STR_LEN;
     }
     // chop spaces at the end [not executed for well-formated datafile]
-    for (p--; p >= s && isspace(*p); p--){
+    while (stop > s && isspace((unsigned char) stop[-1])) {
+        stop--;
+    }
+    *stop = '\0';     // overwrites the terminator, or the spare byte at end
+    return s;
+}
+
+// skip the csv string field that parseCsvString() would get, leaving the
+//    buffer untouched; return: 0 at the end of the buffer, 1 otherwise
+int skipCsvString(char **pos, char *end) {
+    char *stop;
+    return scanCsvString(pos, end, &stop) != NULL;
+}
+
+// like fscanf("%d"), return 1 on success and 0 otherwise
+//    up to 9 digits always fit and are converted directly, longer numbers
+//    are handed over to strtol, and clamped to the range of an int
+int parseInt(char **pos, char *end, int *value) {
+    skipSpaces(pos, end);
+    char *p = *pos;
+    int negative = FALSE;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p >= end || !isdigit((unsigned char) *p)) {
+        return 0;
+    }
+    int v = 0, digits = 0;
+    for (; p < end && isdigit((unsigned char) *p); p++, digits++) {
+        if (digits < INT_DIGITS) {
+            v = v * 10 + (*p - '0');
+        }
+    }
+    if (digits <= INT_DIGITS) {
+        *value = negative ? -v : v;
+        *pos = p;
+        return 1;
+    }
 
+    // slow path: copy the token so that strtol cannot run past "end",
+    //    a token too long to copy is out of range anyway
+    char buf[MAX_STR_LEN + 1];
+    int n = p - *pos < MAX_STR_LEN ? p - *pos : MAX_STR_LEN;
+    memcpy(buf, *pos, n);
+    buf[n] = '\0';
+    long l = strtol(buf, NULL, 10);
+    *value = l > INT_MAX ? INT_MAX : l < INT_MIN ? INT_MIN : l;
+    *pos = p;
+    return 1;
+}
+
+// like fscanf("%lf"), return 1 on success and 0 otherwise
+//    plain decimals with at most 15 significant digits are converted exactly
+//    (and so identically to strtod) by a single multiply or divide,
+//    anything else is handed over to strtod
+int parseDouble(char **pos, char *end, double *value) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
     };
-    *(p + 1) = '\0';
+    skipSpaces(pos, end);
+    char *p = *pos;
+    int negative = FALSE;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    unsigned long long mantissa = 0;
+    int digits = 0, scale = 0;
+    for (; p < end && isdigit((unsigned char) *p); p++, digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && isdigit((unsigned char) *p); p++, digits++, scale++) {
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+    int isPlain = digits > 0 && (p >= end || (*p != 'e' && *p != 'E'
+                                  && *p != 'x' && *p != 'X'));
+    if (isPlain && digits <= 15 && scale <= 22) {
+        double v = (double) mantissa / pow10[scale];
+        *value = negative ? -v : v;
+        *pos = p;
+        return 1;
+    }
 
-    s = myRealloc(s, (strlen(s) + 1) * sizeof(*s));  // shrink s to its size
-    return s;
+    // slow path: copy the token so that strtod cannot run past "end"
+    char buf[MAX_STR_LEN + 1];
+    int n = 0;
+    for (p = *pos; p < end && n < MAX_STR_LEN && !isspace((unsigned char) *p)
+                   && *p != ','; p++) {
+        buf[n++] = *p;
+    }
+    buf[n] = '\0';
+    char *stop;
+    *value = strtod(buf, &stop);
+    if (stop == buf) {
+        return 0;
+    }
+    *pos += stop - buf;
+    return 1;
+}
+
+// skip spaces, then a comma if there is one, then spaces again
+//    return 1 if a comma was skipped
+int parseSeparator(char **pos, char *end) {
+    int comma = FALSE;
+    skipSpaces(pos, end);
+    if (*pos < end && **pos == ',') {
+        (*pos)++;
+        comma = TRUE;
+    }
+    skipSpaces(pos, end);
+    return comma;
+}
+
+// skip the rest of the current line, including its end-of-line
+void parseSkipLine(char **pos, char *end) {
+    char *p = *pos;
+    while (p < end && *p != '\n' && *p != '\r') {
+        p++;
+    }
+    if (p < end) {
+        p++;
+    }
+    *pos = p;
 }
 
 // get an input string from file *f until encountering a newline
@@ -148,109 +295,15 @@ void warning(char *message) {
 
 /* Helper function. Gets the bit at bitIndex from the string s. */
 int getBit(char *s, unsigned int bitIndex){
-    assert(s && bitIndex >= 0);
-    unsigned int byte = bitIndex / BITS_PER_BYTE;
-    unsigned int indexFromLeft = bitIndex % BITS_PER_BYTE;
-    /* 
-        Since we split from the highest order bit first, the bit we are interested
-        will be the highest order bit, rather than a bit that occurs at the end of the
-        number. 
-    */
-    unsigned int offset = (BITS_PER_BYTE - (indexFromLeft) - 1) % BITS_PER_BYTE;
-    unsigned char byteOfInterest = s[byte];
-    unsigned int offsetMask = (1 << offset);
-    unsigned int maskedByte = (byteOfInterest & offsetMask);
-    /*
-        The masked byte will still have the bit in its original position, to return
-        either 0 or 1, we need to move the bit to the lowest order bit in the number.
-    */
-    unsigned int bitOnly = maskedByte >> offset;
-    return bitOnly;
+    return bitsGet(s, bitIndex);
 }
 
 /* Allocates new memory to hold the numBits specified and fills the allocated
     memory with the numBits specified starting from the startBit of the oldKey
     array of bytes. */
 char *createStem(char *oldKey, unsigned int startBit, unsigned int numBits){
-    assert(numBits > 0 && startBit >= 0 && oldKey);
-    int extraBytes = 0;
-    if((numBits % BITS_PER_BYTE) > 0){
-        extraBytes = 1;
-    }
-    int totalBytes = (numBits / BITS_PER_BYTE) + extraBytes;
-    char *newStem = malloc(sizeof(char) * totalBytes);
-    assert(newStem);
-    for(unsigned int i = 0; i < totalBytes; i++){
-        newStem[i] = 0;
-    }
-    for(unsigned int i = 0; i < numBits; i++){
-        unsigned int indexFromLeft = i % BITS_PER_BYTE;
-        unsigned int offset = (BITS_PER_BYTE - indexFromLeft - 1) % BITS_PER_BYTE;
-        unsigned int bitMaskForPosition = 1 << offset;
-        unsigned int bitValueAtPosition = getBit(oldKey, startBit + i);
-        unsigned int byteInNewStem = i / BITS_PER_BYTE;
-        newStem[byteInNewStem] |= bitMaskForPosition * bitValueAtPosition;
-    }
+    assert(numBits > 0 && oldKey);
+    char *newStem = myMalloc((numBits + BITS_PER_BYTE - 1) / BITS_PER_BYTE);
+    bitsCopy(newStem, oldKey, startBit, numBits);
     return newStem;
 }
-
-/* Returns min of 3 integers 
-    reference: https://www.geeksforgeeks.org/edit-distance-in-c/ */
-int min(int a, int b, int c) {
-    if (a < b) {
-        if(a < c) {
-            return a;
-        } else {
-            return c;
-        }
-    } else {
-        if(b < c) {
-            return b;
-        } else {
-            return c;
-        }
-    }
-}
-
-/* Returns the edit distance of two strings
-    reference: https://www.geeksforgeeks.org/edit-distance-in-c/ */
-int editDistance(char *str1, char *str2, int n, int m){
-    assert(m >= 0 && n >= 0 && (str1 || m == 0) && (str2 || n == 0));
-    // Declare a 2D array to store the dynamic programming
-    // table
-    int dp[n + 1][m + 1];
-
-    // Initialize the dp table
-    for (int i = 0; i <= n; i++) {
-        for (int j = 0; j <= m; j++) {
-            // If the first string is empty, the only option
-            // is to insert all characters of the second
-            // string
-            if (i == 0) {
-                dp[i][j] = j;
-            }
-            // If the second string is empty, the only
-            // option is to remove all characters of the
-            // first string
-            else if (j == 0) {
-                dp[i][j] = i;
-            }
-            // If the last characters are the same, no
-            // modification is necessary to the string.
-            else if (str1[i - 1] == str2[j - 1]) {
-                dp[i][j] = min(1 + dp[i - 1][j], 1 + dp[i][j - 1],
-                    dp[i - 1][j - 1]);
-            }
-            // If the last characters are different,
-            // consider all three operations and find the
-            // minimum
-            else {
-                dp[i][j] = 1 + min(dp[i - 1][j], dp[i][j - 1],
-                    dp[i - 1][j - 1]);
-            }
-        }
-    }
-
-    // Return the result from the dynamic programming table
-    return dp[n][m];
-}
\ No newline at end of file
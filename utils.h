@@ -41,9 +41,35 @@ FILE *myFopen(const char *fname, const char *mode);
 /*--------- some useful string functions  --------------*/
 char *myStrdup(char *);
 
-// get string field from well-formatted .csv fileName
-// cut-off and ignore from MAX_STR_LEN-th char if applicable
-char *getCsvString(FILE *f);
+// FNV-1a hash of a string
+unsigned int hashString(const char *s);
+
+/*--------- parsing a csv file mapped into memory  -----------*/
+/* Each function parses the field starting at *pos, never reads at or past
+    "end", and advances *pos past what it consumed. */
+
+// get a csv string field, quoted or ended by a comma or newline, cut-off
+//    from the MAX_STR_LEN-th char if applicable; the field is terminated
+//    in place with '\0' and a pointer into the buffer is returned, the
+//    buffer must have a writable byte at "end"
+char *parseCsvString(char **pos, char *end);
+
+// skip the csv string field that parseCsvString() would get, leaving the
+//    buffer untouched; return: 0 at the end of the buffer, 1 otherwise
+int skipCsvString(char **pos, char *end);
+
+// like fscanf("%d"), return 1 on success and 0 otherwise
+int parseInt(char **pos, char *end, int *value);
+
+// like fscanf("%lf"), return 1 on success and 0 otherwise
+int parseDouble(char **pos, char *end, double *value);
+
+// skip spaces, then a comma if there is one, then spaces again
+//    return 1 if a comma was skipped
+int parseSeparator(char **pos, char *end);
+
+// skip the rest of the current line, including its end-of-line
+void parseSkipLine(char **pos, char *end);
 
 // get an input string (ended with \n or \r) from file *f
 // cut-off and ignore from MAX_BUF_LEN-th char if applicable
@@ -64,14 +90,6 @@ int getBit(char *s, unsigned int bitIndex);
     array of bytes. */
 char *createStem(char *oldKey, unsigned int startBit, unsigned int numBits);
 
-/* Returns min of 3 integers 
-    reference: https://www.geeksforgeeks.org/edit-distance-in-c/ */
-int min(int a, int b, int c);
-
-/* Returns the edit distance of two strings
-    reference: https://www.geeksforgeeks.org/edit-distance-in-c/ */
-int editDistance(char *str1, char *str2, int n, int m);
-
 /* TRACING */
 #if 0
 #define TRACE printf("TRACE: file %s funct %s line %d\n", __FILE__, __FUNCTION__, __LINE__);